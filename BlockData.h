@@ -0,0 +1,75 @@
+/*  Part of SWI-Prolog interface to Qt
+
+    Author:        SWI-Prolog contributors
+    WWW:           https://www.swi-prolog.org
+    Copyright (c)  2026, SWI-Prolog contributors
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions
+    are met:
+
+    1. Redistributions of source code must retain the above copyright
+       notice, this list of conditions and the following disclaimer.
+
+    2. Redistributions in binary form must reproduce the above copyright
+       notice, this list of conditions and the following disclaimer in
+       the documentation and/or other materials provided with the
+       distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+    FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+    COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+    INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+    BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+    LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+    ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#ifndef BLOCKDATA_H
+#define BLOCKDATA_H
+
+#include <QChar>
+#include <QVector>
+#include <QTextBlock>
+#include <QTextBlockUserData>
+
+/** per line data attached to console document blocks
+ *
+ *  Block userState() holds the lexical state at end of line, or -1
+ *  when the line changed since scanned (see ParenMatching::invalidate).
+ *  Message references are set by the console, as output is appended.
+ */
+struct BlockData : public QTextBlockUserData {
+
+    /** lexical state and offset the bracket index was scanned from */
+    int in = -1, from = -1;
+
+    /** brackets outside quotes and comments, by position in block */
+    struct bracket {
+        int pos;
+        QChar c;
+    };
+    QVector<bracket> brackets;
+
+    /** source reference of an ERROR/Warning line, detected when appended */
+    QString msg_file;
+    int msg_line = 0, msg_col = 0;
+    bool is_message() const { return msg_line > 0; }
+
+    /** data of block, created if missing */
+    static BlockData *of(QTextBlock b) {
+        auto d = static_cast<BlockData*>(b.userData());
+        if (!d)
+            b.setUserData(d = new BlockData);
+        return d;
+    }
+};
+
+#endif // BLOCKDATA_H
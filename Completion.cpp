@@ -34,21 +34,12 @@
 #include "Completion.h"
 #include "PREDICATE.h"
 #include "SwiPrologEngine.h"
+#include "PredicateIndex.h"
+#include "DocIndex.h"
 #include <QDebug>
 #include <QFile>
 #include <QTextStream>
 
-struct Bin : C { Bin(CCP op, T Left, T Right) : C(op, V(Left, Right)) {} };
-struct Uni : C { Uni(CCP op, T arg) : C(op, PlTermv(arg)) {} };
-
-struct quv : Bin { quv(T Var, T Expr) : Bin("^", Var, Expr) {} };
-struct mod : Bin { mod(T Mod, T Pred) : Bin(":", Mod, Pred) {} };
-struct neg : Uni { neg(T pred) : Uni("\\+", pred) {} };
-struct join : Bin { join(T Left, T Right) : Bin(",", Left, Right) {} };
-struct arith : Bin { arith(T Pred, T Num) : Bin("/", Pred, Num) {} };
-
-#define _V PlTerm_var()
-
 /** context sensitive completion
  *  take current line, give list of completions (both atoms and files)
  *  thanks to Jan for crafting a proper interface wrapping SWI-Prolog available facilities
@@ -56,19 +47,28 @@ struct arith : Bin { arith(T Pred, T Num) : Bin("/", Pred, Num) {} };
 QString Completion::initialize(int promptPosition, QTextCursor c, QStringList &strings) {
 
     SwiPrologEngine::in_thread _int;
-    QString rets;
+    if (!_int)
+	return QString();
 
-    try {
-	int p = c.position();
-	Q_ASSERT(p >= promptPosition);
+    int p = c.position();
+    Q_ASSERT(p >= promptPosition);
 
-	c.setPosition(promptPosition, c.KeepAnchor);
-	QString left = c.selectedText();
-	PlTerm_string Before(left.toStdWString());
+    c.setPosition(promptPosition, c.KeepAnchor);
+    QString before = c.selectedText();
 
-	c.setPosition(p);
-	c.movePosition(c.EndOfLine, c.KeepAnchor);
-	QString after = c.selectedText();
+    c.setPosition(p);
+    c.movePosition(c.EndOfLine, c.KeepAnchor);
+    return complete(before, c.selectedText(), strings);
+}
+
+/** run prolog:complete_input/4 in calling thread
+ *  an exception (as from QueryHandle::cancel) leaves strings incomplete
+ */
+QString Completion::complete(QString before, QString after, QStringList &strings) {
+
+    QString rets;
+    try {
+	PlTerm_string Before(before.toStdWString());
 	PlTerm_string After(after.toStdWString());
 
 	PlTerm_var Completions, Delete, word;
@@ -79,7 +79,6 @@ QString Completion::initialize(int promptPosition, QTextCursor c, QStringList &s
 	    PlCheckFail(l.close());
 	}
 
-	c.setPosition(p);
 	rets = t2w(Delete);
     }
     catch(const PlException& e) {
@@ -92,41 +91,29 @@ QString Completion::initialize(int promptPosition, QTextCursor c, QStringList &s
     return rets;
 }
 
-/** issue a query filling the model storage
- *  this will change when I will learn how to call SWI-Prolog completion interface
+/** fill the model storage with predicate names, from PredicateIndex
+ *  empty until the index has been built
  */
 void Completion::initialize(QStringList &strings) {
-
-    SwiPrologEngine::in_thread _int;
-    try {
-	PlTerm_var p,m,a,l,v;
-	PlQuery q("setof",
-	    PlTermv(p,
-		quv(m,
-		    quv(a,
-			join(PlCompound("current_predicate", PlTermv(mod(m, arith(p, a)))),
-			     neg(C("sub_atom", PlTermv(p, PlTerm_integer(0), PlTerm_integer(1),
-						       _V, PlTerm_atom(A("$")))))
-		))),
-	    l));
-	if (q.next_solution())
-	    for (PlTerm_tail x(l); x.next(v); )
-	      strings.append(v.as_string().c_str());
-    }
-    catch(const PlException& e) {
-	qDebug() << CCP(e);
-    }
+    auto snp = PredicateIndex::instance()->current();
+    if (!snp)
+	return;
+    QStringView last;
+    for (const auto &e : snp->entries)
+	if (snp->name(e) != last)
+	    strings.append((last = snp->name(e)).toString());
 }
 
 Completion::status Completion::setup_status = Completion::untried;
-Completion::t_pred_docs Completion::pred_docs;
 
 /** initialize and cache all predicates with description
  */
 bool Completion::setup() {
     if (setup_status == untried) {
-	setup_status = missing;
 	SwiPrologEngine::in_thread _e;
+	if (!_e)
+	    return false;
+	setup_status = missing;
 	try {
 	    if ( PlCall("load_files(library(console_input), [silent(true)])") &&
 		 PlCall("current_predicate(prolog:complete_input/4)")) {
@@ -141,23 +128,16 @@ bool Completion::setup() {
     return setup_status == available;
 }
 
-/** access/compute predicate description tip from cached
- * FIXME: Base tooltip on a callback
+/** predicate description tip, from DocIndex
+ *  a line for each documented arity of word under cursor
  */
 QString Completion::pred_tip(QTextCursor c) {
-    Q_UNUSED(c)
-#if 0
-    if (helpidx_status == available) {
-	c.select(c.WordUnderCursor);
-	QString w =  c.selectedText();
-	auto p = pred_docs.constFind(w);
-	if (p != pred_docs.end()) {
-	    QStringList l;
-	    foreach(auto x, p.value())
-		l.append(QString("%1/%2:%3").arg(w).arg(x.first).arg(x.second));
-	    return l.join("\n");
-	}
-    }
-#endif
-    return "";
+    c.select(c.WordUnderCursor);
+    QString w = c.selectedText();
+    if (w.isEmpty())
+	return "";
+    QStringList l;
+    foreach (auto d, DocIndex::instance()->lookup(w))
+	l.append(QString("%1/%2: %3").arg(w).arg(d.arity).arg(d.summary));
+    return l.join("\n");
 }
@@ -48,23 +48,20 @@ struct PQCONSOLESHARED_EXPORT Completion
     /** context sensitive completion */
     static QString initialize(int promptPosition, QTextCursor cursor, QStringList &strings);
 
-    /** load predicates into strings */
+    /** as above, on line text around cursor - caller must have an engine attached */
+    static QString complete(QString before, QString after, QStringList &strings);
+
+    /** load predicate names into strings, from PredicateIndex */
     static void initialize(QStringList &strings);
 
-    /** tooltips display, from helpidx.pl */
+    /** context sensitive completion, from console_input.pl */
     enum status { untried, available, missing };
     static status setup_status;
 
-    /** predicate -> declarations */
-    typedef QPair<int, QString> t_decl;
-    typedef QList<t_decl> t_decls;
-    typedef QMap<QString, t_decls> t_pred_docs;
-    static t_pred_docs pred_docs;
-
     /** initialize if required, return true if available */
     static bool setup();
 
-    /** access/compute predicate description tip from cached */
+    /** predicate description tip, from DocIndex */
     static QString pred_tip(QTextCursor c);
 };
 
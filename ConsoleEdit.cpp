@@ -33,6 +33,7 @@
 
 #include <SWI-Stream.h>
 #include <signal.h>
+#include <climits>
 
 #include "Swipl_IO.h"
 #include "do_events.h"
@@ -40,9 +41,13 @@
 #include "Completion.h"
 #include "Preferences.h"
 #include "pqMainWindow.h"
+#include "RepaintScheduler.h"
+#include "GuiCommands.h"
+#include "PredicateIndex.h"
+#include "DocIndex.h"
 
-#include "blockSig.h"
 #include "ParenMatching.h"
+#include "BlockData.h"
 #include <QTextBlock>
 
 #include <QTime>
@@ -58,8 +63,9 @@
 #include <QApplication>
 #include <QStringListModel>
 #include <QClipboard>
-
-#include "ansi_esc_seq.h"
+#include <QReadWriteLock>
+#include <QScrollBar>
+#include <QAbstractTextDocumentLayout>
 
 /** peek color by index */
 static QColor ANSI2col(int c, bool highlight = false) { return Preferences::ANSI2col(c, highlight); }
@@ -84,7 +90,6 @@ ConsoleEdit::ConsoleEdit(int argc, char **argv, QWidget *parent)
     eng = new SwiPrologEngine(this);
 
     // wire up console IO
-    connect(eng, SIGNAL(user_output(QString)), this, SLOT(user_output(QString)));
     connect(eng, SIGNAL(user_prompt(int, bool)), this, SLOT(user_prompt(int, bool)));
     connect(this, SIGNAL(user_input(QString)), eng, SLOT(user_input(QString)));
 
@@ -100,7 +105,30 @@ ConsoleEdit::ConsoleEdit(int argc, char **argv, QWidget *parent)
 void ConsoleEdit::add_thread(int id) {
     Q_ASSERT(id > 0);
     Q_ASSERT(thids.empty());
+    bind_thread(id);
+}
+
+/** Prolog thread id -> console, read by foreign predicates running in Prolog threads
+ */
+static QHash<int, ConsoleEdit*> consoles;
+static QReadWriteLock consoles_lock;
+
+void ConsoleEdit::bind_thread(int id) {
+    QWriteLocker lk(&consoles_lock);
     thids.append(id);
+    consoles.insert(id, this);
+}
+
+void ConsoleEdit::unbind_thread(int id) {
+    QWriteLocker lk(&consoles_lock);
+    thids.removeOne(id);
+    if (consoles.value(id) == this)
+        consoles.remove(id);
+}
+
+ConsoleEdit *ConsoleEdit::by_thread(int thread_id) {
+    QReadLocker lk(&consoles_lock);
+    return consoles.value(thread_id);
 }
 
 /** this start an *interactor* console hosted in a QMainWindow
@@ -124,6 +152,18 @@ ConsoleEdit::ConsoleEdit(Swipl_IO* io)
     setup(io);
 }
 
+/** the pipe lives on the output worker: release it there
+ */
+ConsoleEdit::~ConsoleEdit() {
+    RepaintScheduler::instance()->remove(this);
+    if (completion_query)
+        completion_query->cancel();
+    foreach (int id, QList<int>(thids))
+        unbind_thread(id);
+    pipe->detach();
+    pipe->deleteLater();
+}
+
 /** more factorization, after introducing the possibility
  *  of instancing in a tabbed interface
  */
@@ -132,7 +172,6 @@ void ConsoleEdit::setup(Swipl_IO* io) {
     setup();
 
     // wire up console IO
-    connect(io, SIGNAL(user_output(QString)), this, SLOT(user_output(QString)));
     connect(io, SIGNAL(user_prompt(int, bool)), this, SLOT(user_prompt(int, bool)));
     connect(this, SIGNAL(user_input(QString)), io, SLOT(user_input(QString)));
 
@@ -149,10 +188,21 @@ void ConsoleEdit::setup() {
     status = idle;
     promptPosition = -1;
 
-    qApp->installEventFilter(this);
-    count_output = 0;
+    // hover is sensed on this viewport only: hidden consoles get no events
+    viewport()->setMouseTracking(true);
+    output_backlog = 256 * 1024;
     update_refresh_rate = 100;
+    pipe = new OutputPipe(output, this);
+    pipe->set_limit(size_t(output_backlog));
+    pipe->moveToThread(OutputPipe::worker());
+    out_back = 0;
+    paste_off = 0;
+    scrollback_lines = 5000;
+    scrollback.setMemoryLimit(qint64(64) << 20);
+    paged_in = 0;
     preds = 0;
+    completion_gen = 0;
+    completion_described = completion_refresh = false;
 
     Preferences p;
 
@@ -169,9 +219,15 @@ void ConsoleEdit::setup() {
     setFont(p.console_font);
 
     connect(this, SIGNAL(cursorPositionChanged()), this, SLOT(onCursorPositionChanged()));
+    connect(verticalScrollBar(), SIGNAL(valueChanged(int)), this, SLOT(scrolled(int)));
 
     connect(this, SIGNAL(sig_run_function(pfunc)), this, SLOT(run_function(pfunc)));
 
+    // keep the bracket index current: edited lines are scanned again on demand
+    connect(document(), &QTextDocument::contentsChange, this, [this](int p, int r, int a) {
+        ParenMatching::invalidate(document(), p, r, a);
+    });
+
     // so far,
     connect(this, SIGNAL(selectionChanged()), this, SLOT(selectionChanged()));
 
@@ -215,6 +271,8 @@ void ConsoleEdit::set_colors() {
 
     input_text_fmt.setForeground(ANSI2col(Preferences::console_inp_fore));
     input_text_fmt.setBackground(ANSI2col(Preferences::console_inp_back));
+
+    style_formats.clear();
 }
 
 /** strict control on keyboard events required
@@ -237,7 +295,7 @@ void ConsoleEdit::keyPressEvent(QKeyEvent *event) {
             event->ignore();
             return; // let the completer do default behavior
         default:
-            compinit(c);
+            compinit(completion_described, completion_debounce, true);
             break;
         }
     }
@@ -252,7 +310,7 @@ void ConsoleEdit::keyPressEvent(QKeyEvent *event) {
 
     case Key_Space:
         if (!on_completion && ctrl && editable) {
-            compinit2(c);
+            compinit(true);
             return;
         }
         accept = editable;
@@ -263,7 +321,7 @@ void ConsoleEdit::keyPressEvent(QKeyEvent *event) {
             return;
         }
         if (!on_completion && !ctrl && editable) {
-            compinit(c);
+            compinit(false);
             return;
         }
         break;
@@ -369,7 +427,9 @@ void ConsoleEdit::keyPressEvent(QKeyEvent *event) {
     // case Key_Pause: I thought this one also work. It's not true.
         if (ctrl && status == running) {
             qDebug() << "^C" << thids << status;
-            PL_thread_raise(thids[0], SIGINT);
+            if (paste_timer.isActive())
+                paste_stop();
+            int_request();
             return;
         }
         // fall through
@@ -440,50 +500,121 @@ void ConsoleEdit::insertCompletion(QString completion) {
     int sep = completion.indexOf(" | ");
     if (sep > 0)    // remove description
         completion = completion.left(sep);
-    int extra = completion.length() - preds->completionPrefix().length();
-    textCursor().insertText(completion.right(extra));
+    QString prefix = preds->completionPrefix();
+    QTextCursor c = textCursor();
+    if (completion.startsWith(prefix))
+        c.insertText(completion.mid(prefix.length()));
+    else {
+        // a fuzzy match: replace what was typed
+        c.movePosition(c.Left, c.KeepAnchor, prefix.length());
+        c.insertText(completion);
+    }
 }
 
-/** completion initialize
- *  this is the simpler setup I found so far
+/** completion request
+ *  a newer request supersedes any pending or running one
+ */
+void ConsoleEdit::compinit(bool described, int delay, bool refresh) {
+    ++completion_gen;
+    if (completion_query)
+        completion_query->cancel();
+    completion_described = described;
+    completion_refresh = refresh;
+    // the index answers within a frame: just wait the key to be processed
+    if (described && PredicateIndex::instance()->ready())
+        delay = 0;
+    completion_timer.start(delay, this);
+}
+
+/** run prolog:complete_input/4 on QueryExecutor
+ *  results come back queued, and are dropped if outdated meanwhile
  */
-void ConsoleEdit::compinit(QTextCursor c) {
+void ConsoleEdit::completion_start() {
+    completion_timer.stop();
 
-    /*/ issue setof(M,current_module(M),L)
-    QStringList lmods;
-    {   SwiPrologEngine::in_thread _it;
-        PlTerm M, Ms;
-        if (PlCall("setof", PlTermv(M, PlCompound("current_module", M), Ms)))
-            for (PlTail x(Ms); x.next(M); )
-                lmods.append(CCP(M));
+    if (completion_described && PredicateIndex::instance()->ready()) {
+        completion_index(completion_refresh);
+        return;
     }
-    */
 
-    QStringList lpreds;
-    QString prefix = Completion::initialize(fixedPosition, c, lpreds);
+    QTextCursor c = textCursor();
+    int p = c.position();
+    if (p < fixedPosition)
+        return;
 
-    if (!preds) {
-        preds = new t_Completion(new QStringListModel(lpreds));
-        preds->setWidget(this);
-        connect(preds, SIGNAL(activated(QString)), this, SLOT(insertCompletion(QString)));
-    }
-    else {
-        auto model = qobject_cast<QStringListModel*>(preds->model());
-        model->setStringList(lpreds);
-    }
+    c.setPosition(fixedPosition, c.KeepAnchor);
+    QString before = c.selectedText();
+    c.setPosition(p);
+    c.movePosition(c.EndOfLine, c.KeepAnchor);
+    QString after = c.selectedText();
+
+    int gen = completion_gen;
+    bool described = completion_described, refresh = completion_refresh;
+    QPointer<QObject> self = this;
+
+    completion_query = QueryExecutor::instance()->submit([=]() {
+        QStringList strings;
+        QString prefix = Completion::complete(before, after, strings);
+        GuiCommands::instance()->post(self, [=]() {
+            if (gen == completion_gen)
+                completion_show(prefix, strings, described, refresh);
+        });
+    }, QueryExecutor::Interactive);
+}
 
-    preds->setCompletionPrefix(prefix);
-    preds->popup()->setCurrentIndex(preds->completionModel()->index(0, 0));
+/** rank index names by fuzzy match with the identifier left of cursor
+ *  a name/arity defined in several modules is listed once
+ */
+void ConsoleEdit::completion_index(bool refresh) {
+    QTextCursor c = textCursor();
+    if (c.position() < fixedPosition)
+        return;
 
-    QRect cr = cursorRect();
-    cr.setWidth(300);
-    preds->complete(cr);
+    QString line = c.block().text();
+    int e = c.positionInBlock(), b = e;
+    int stop = qMax(0, e - (c.position() - fixedPosition));
+    while (b > stop && (line[b - 1].isLetterOrNumber() || line[b - 1] == '_'))
+        --b;
+    QString prefix = line.mid(b, e - b);
+
+    auto snp = PredicateIndex::instance()->current();
+    const int n = snp->entries.size();
+
+    QStringList items;
+    foreach (int f, snp->fuzzy(prefix, completion_max)) {
+        for (int i = f; i < n && snp->entries[i].off == snp->entries[f].off; ) {
+            const auto &x = snp->entries[i];
+            QStringList mods;
+            for ( ; i < n && snp->entries[i].off == x.off && snp->entries[i].arity == x.arity; ++i)
+                mods.append(snp->module(snp->entries[i]));
+
+            QString name = snp->name(x).toString(), descr = DocIndex::instance()->summary(name, x.arity);
+            if (descr.isEmpty())
+                descr = mods.join(", ");
+
+            QStringList la;
+            for (int a = 0; a < x.arity; ++a)
+                la.append(QString(QChar('A' + a)));
+            if (!la.isEmpty())
+                items.append(QString("%1(%2) | %3").arg(name).arg(la.join(", ")).arg(descr));
+            else
+                items.append(QString("%1 | %2").arg(name).arg(descr));
+        }
+        if (items.size() >= completion_max)
+            break;
+    }
+
+    completion_show(prefix, items, false, refresh, true);
 }
 
-void ConsoleEdit::compinit2(QTextCursor c) {
+/** completion display
+ *  this is the simpler setup I found so far
+ */
+void ConsoleEdit::completion_show(QString prefix, QStringList strings, bool describe, bool refresh, bool ranked) {
 
-    QStringList atoms;
-    QString prefix = Completion::initialize(fixedPosition, c, atoms);
+    bool visible = preds && preds->popup()->isVisible();
+    if (refresh && !visible)
+        return;
 
     if (!preds) {
         preds = new t_Completion(new QStringListModel());
@@ -492,30 +623,42 @@ void ConsoleEdit::compinit2(QTextCursor c) {
     }
 
     QStringList lpreds;
-    foreach (auto a, atoms) {
-        auto p = Completion::pred_docs.constFind(a);
-        if (p != Completion::pred_docs.constEnd()) // was pred_docs.end(), seems a Qt bug it's allowed
-            foreach (auto d, p.value()) {
+    if (describe)
+        foreach (auto a, strings) {
+            auto docs = DocIndex::instance()->lookup(a);
+            foreach (auto d, docs) {
                 QStringList la;
-                for (int n = 0; n < d.first; ++n)
+                for (int n = 0; n < d.arity; ++n)
                     la.append(QString(QChar('A' + n)));
                 if (!la.isEmpty())
-                    lpreds.append(QString("%1(%2) | %3").arg(a).arg(la.join(", ")).arg(d.second));
+                    lpreds.append(QString("%1(%2) | %3").arg(a).arg(la.join(", ")).arg(d.summary));
                 else
-                    lpreds.append(QString("%1 | %2").arg(a).arg(d.second));
+                    lpreds.append(QString("%1 | %2").arg(a).arg(d.summary));
             }
-        else
-            lpreds.append(a);
-    }
+            if (docs.isEmpty())
+                lpreds.append(a);
+        }
+    else
+        lpreds = strings;
 
     auto model = qobject_cast<QStringListModel*>(preds->model());
     model->setStringList(lpreds);
 
-    preds->setCompletionPrefix(prefix);
+    // ranked items are already filtered, and don't need to start with prefix
+    preds->setCompletionMode(ranked ? QCompleter::UnfilteredPopupCompletion : QCompleter::PopupCompletion);
+
+    // while the popup is open, keyPressEvent keeps the prefix at the word typed
+    if (!visible || ranked)
+        preds->setCompletionPrefix(prefix);
+    else {
+        QTextCursor c = textCursor();
+        c.select(QTextCursor::WordUnderCursor);
+        preds->setCompletionPrefix(c.selectedText());
+    }
     preds->popup()->setCurrentIndex(preds->completionModel()->index(0, 0));
 
     QRect cr = cursorRect();
-    cr.setWidth(400);
+    cr.setWidth(completion_described ? 400 : 300);
     preds->complete(cr);
 }
 
@@ -527,10 +670,77 @@ void ConsoleEdit::focusInEvent(QFocusEvent *e) {
     ConsoleEditBase::focusInEvent(e);
 }
 
+/** stream a large paste to the engine, without copying it in the document
+ *  the reader doesn't prompt while the feed is active
+ */
+void ConsoleEdit::paste_start(QString text) {
+    paste_text = text;
+    paste_off = 0;
+    if (io)
+        io->feeding(true);
+    else
+        eng->feeding(true);
+    status = running;
+    paste_timer.start(10, this);
+    paste_feed();
+}
+
+/** push chunks while the engine input has room
+ */
+void ConsoleEdit::paste_feed() {
+    const int chunk = 16 * 1024;
+    for (int k = 0; k < 16 && paste_off < paste_text.length(); ++k) {
+        int n = qMin(chunk, paste_text.length() - paste_off);
+        if (paste_off + n < paste_text.length() && paste_text[paste_off + n - 1].isHighSurrogate())
+            --n;
+        QByteArray b = paste_text.mid(paste_off, n).toUtf8();
+        if (!(io ? io->feed_input(b) : eng->feed_input(b)))
+            return;
+        paste_off += n;
+    }
+    if (paste_off == paste_text.length())
+        paste_stop();
+}
+
+void ConsoleEdit::paste_stop() {
+    paste_timer.stop();
+    paste_text.clear();
+    paste_off = 0;
+    if (io)
+        io->feeding(false);
+    else
+        eng->feeding(false);
+}
+
+void ConsoleEdit::timerEvent(QTimerEvent *e) {
+    if (e->timerId() == paste_timer.timerId())
+        paste_feed();
+    else if (e->timerId() == completion_timer.timerId())
+        completion_start();
+    else if (e->timerId() == hover_timer.timerId())
+        hover();
+    else
+        ConsoleEditBase::timerEvent(e);
+}
+
+/** output of hidden console is parked by RepaintScheduler
+ */
+void ConsoleEdit::showEvent(QShowEvent *e) {
+    ConsoleEditBase::showEvent(e);
+    RepaintScheduler::instance()->post(this);
+}
+
 /** filter out insertion when cursor is not in editable position
  */
 void ConsoleEdit::insertFromMimeData(const QMimeData *source) {
     qDebug() << "insertFromMimeData" << source;
+    if (source->hasText() && !paste_timer.isActive()) {
+        QString text = source->text();
+        if (text.length() > paste_stream_limit) {
+            paste_start(text);
+            return;
+        }
+    }
     auto c = textCursor();
     if (c.position() >= fixedPosition)
         ConsoleEditBase::insertFromMimeData(source);
@@ -542,14 +752,13 @@ void ConsoleEdit::insertFromMimeData(const QMimeData *source) {
 
 /** \brief send text to output
  *
- *  Decode ANSI terminal sequences, to output coloured text.
+ *  Text comes already decoded, and split in styled runs by the pipe.
  *  Colours encoding are (approx) derived from swipl console.
+ *  Carriage return, cursor movement and erase are applied in place,
+ *  so a line redrawn by a progress indicator doesn't grow the document.
  */
-void ConsoleEdit::user_output(QString text) {
-
-#if defined(Q_OS_WIN)
-    text.replace("\r\n", "\n");
-#endif
+void ConsoleEdit::user_output(const OutputPipe::batch &b) {
+    const QString &text = b.text;
 
     QTextCursor c = textCursor();
     if (status == wait_input)
@@ -559,9 +768,12 @@ void ConsoleEdit::user_output(QString text) {
         c.movePosition(QTextCursor::End);
     }
 
-    auto instext = [&](QString text) {
+    int from = out_base(), to = from;
+    auto instext = [&](QString text, const QTextCharFormat &fmt) {
+        c.setPosition(out_base());
+        from = qMin(from, c.position());
         if (color_term)
-            c.insertText(text, output_text_fmt);
+            c.insertText(text, fmt);
         else
             c.insertText(text);
         if (status == wait_input) {
@@ -570,78 +782,394 @@ void ConsoleEdit::user_output(QString text) {
             fixedPosition += ltext;
             ensureCursorVisible();
         }
+        to = qMax(to, c.position());
     };
 
-    ANSI_ESC_SEQ filter(text, output_text_fmt);
-    if (filter)
-        while (filter)
-            instext(filter.next());
+    foreach (const ANSI_ESC_SEQ::run &r, b.runs) {
+        const QTextCharFormat &fmt = style_format(b.styles[r.style]);
+        if (r.op) {
+            out_control(c, r, fmt);
+            continue;
+        }
+        QString t = r.off == 0 && r.len == text.length() ? text : text.mid(r.off, r.len);
+        if (out_back > 0)
+            t = out_overwrite(c, t, fmt);
+        if (!t.isEmpty())
+            instext(t, fmt);
+    }
+
+    if (to > from)
+        scan_messages(from, to);
+}
+
+/** where output is appended: before the prompt while waiting input, else at end
+ */
+int ConsoleEdit::out_base() const {
+    return status == wait_input ? promptPosition : document()->characterCount() - 1;
+}
+
+/** adjust editing positions after output text in [at, at+removed) became <added> chars long
+ */
+void ConsoleEdit::out_shift(int at, int removed, int added) {
+    auto shift = [=](int &q) {
+        if (q >= at + removed)
+            q += added - removed;
+        else if (q > at)
+            q = at;
+    };
+    shift(fixedPosition);
+    shift(promptPosition);
+}
+
+/** replace [from, to) with text, keeping positions in sync
+ */
+void ConsoleEdit::out_replace(QTextCursor &c, int from, int to, QString text, const QTextCharFormat &fmt) {
+    c.setPosition(from);
+    c.setPosition(to, c.KeepAnchor);
+    if (text.isEmpty())
+        c.removeSelectedText();
+    else if (color_term)
+        c.insertText(text, fmt);
     else
-        instext(text);
+        c.insertText(text);
+    out_shift(from, to - from, text.length());
+}
 
-#if 0
-    // filter and apply (some) ANSI sequence
-    int pos = text.indexOf(0x1b);
-    if (pos >= 0) {
+/** terminal cursor is before the append position: overwrite existing characters
+ *  return what's left to be appended
+ */
+QString ConsoleEdit::out_overwrite(QTextCursor &c, QString t, const QTextCharFormat &fmt) {
+    int from = 0;
+    while (from < t.length() && out_back > 0) {
+        int nl = t.indexOf('\n', from), end = nl < 0 ? t.length() : nl;
+        int base = out_base(), P = base - out_back;
+        QTextBlock b = document()->findBlock(P);
+        if (end > from) {
+            int eol = qMin(b.position() + b.length() - 1, base);
+            int k = qMin(end - from, eol - P);
+            out_replace(c, P, P + k, t.mid(from, end - from), fmt);
+            out_back -= k;
+        }
+        if (nl < 0)
+            return QString();
+
+        // line feed moves to next line, or back to append mode on the last one
+        base = out_base();
+        b = document()->findBlock(base - out_back);
+        int next = b.position() + b.length();
+        if (next <= base) {
+            out_back = base - next;
+            from = nl + 1;
+        } else {
+            out_back = 0;
+            from = nl;
+        }
+    }
+    return t.mid(from);
+}
 
-//QTextStream out(stdout);
-//out << text << endl;
+/** apply a cursor movement or erase command to the output tail
+ */
+void ConsoleEdit::out_control(QTextCursor &c, const ANSI_ESC_SEQ::run &r, const QTextCharFormat &fmt) {
+    int P = out_base() - out_back;
+    QTextBlock b = document()->findBlock(P);
+    int col = P - b.position();
 
-        int left = 0;
+    auto eol = [&](QTextBlock t) {
+        return qMin(t.position() + t.length() - 1, out_base());
+    };
+    auto to = [&](int q) {
+        out_back = out_base() - q;
+    };
+    auto to_column = [&](QTextBlock t, int column) {
+        int e = eol(t), q = t.position() + column;
+        if (q > e)
+            out_replace(c, e, e, QString(q - e, ' '), fmt);
+        to(q);
+    };
+    auto blank = [&](int from, int upto) {
+        if (upto > from)
+            out_replace(c, from, upto, QString(upto - from, ' '), fmt);
+    };
+    // the terminal screen: as many lines as fit the view, ending at output tail
+    auto screen_top = [&]() {
+        int rows = qMax(1, viewport()->height() / qMax(1, fontMetrics().lineSpacing()));
+        QTextBlock t = document()->findBlock(out_base());
+        for ( ; rows > 1 && t.previous().isValid(); --rows)
+            t = t.previous();
+        return t;
+    };
+    // remove text of lines from <t> up to block number <upto> excluded, keeping
+    // line breaks: last first, so positions of lines still to clear don't move
+    auto empty_lines = [&](QTextBlock t, int upto) {
+        QList<QTextBlock> l;
+        for ( ; t.isValid() && t.blockNumber() < upto; t = t.next())
+            l.prepend(t);
+        foreach (QTextBlock x, l)
+            if (eol(x) > x.position())
+                out_replace(c, x.position(), eol(x), QString(), fmt);
+    };
 
-        static QRegExp eseq("\x001b\\[(?:(3([0-7]);([01])m)|(0m)|(1m;)|1;3([0-7])m|(1m)|(?:3([0-7])m))");
+    switch (r.op) {
+    case '\r':
+        to(b.position());
+        break;
+    case '\b':
+        if (col > 0)
+            to(P - 1);
+        break;
+    case 'D':   // CUB
+        to(P - qMin(col, qMax(r.arg(1), 1)));
+        break;
+    case 'C':   // CUF
+        to_column(b, col + qMax(r.arg(1), 1));
+        break;
+    case 'G':   // CHA
+        to_column(b, qMax(r.arg(1), 1) - 1);
+        break;
+    case 'A':   // CUU
+    case 'F':   // CPL
+        for (int n = qMax(r.arg(1), 1); n > 0 && b.previous().isValid(); --n)
+            b = b.previous();
+        to_column(b, r.op == 'F' ? 0 : col);
+        break;
+    case 'B':   // CUD
+    case 'E':   // CNL
+        for (int n = qMax(r.arg(1), 1); n > 0 && b.next().isValid() && b.next().position() <= out_base(); --n)
+            b = b.next();
+        to_column(b, r.op == 'E' ? 0 : col);
+        break;
+    case 'K':   // EL
+        switch (r.arg(0)) {
+        case 0:
+            out_replace(c, P, eol(b), QString(), fmt);
+            to(P);
+            break;
+        case 1:
+            blank(b.position(), qMin(P + 1, eol(b)));
+            break;
+        default:
+            out_replace(c, b.position(), eol(b), QString(), fmt);
+            to_column(document()->findBlock(P - col), col);
+        }
+        break;
+    case 'J':   // ED
+        switch (r.arg(0)) {
+        case 0:
+            out_replace(c, P, out_base(), QString(), fmt);
+            out_back = 0;
+            break;
+        case 1:
+            // cursor is kept relative to output tail: clearing before it doesn't move it
+            blank(b.position(), qMin(P + 1, eol(b)));
+            empty_lines(screen_top(), b.blockNumber());
+            break;
+        case 2: {
+            // history above the screen stays, as in terminals
+            QTextBlock t = screen_top();
+            if (b.blockNumber() < t.blockNumber())
+                t = b;
+            empty_lines(t, document()->findBlock(out_base()).blockNumber() + 1);
+            to_column(b, col);
+            break;
+        }
+        default:
+            out_replace(c, 0, out_base(), QString(), fmt);
+            out_back = 0;
+            scrollback.clear();
+            paged_in = 0;
+            top_changed();
+        }
+        break;
+    }
+}
 
-        forever {
-            int pos1 = eseq.indexIn(text, pos);
-            if (pos1 == -1)
-                break;
+/** move excess top lines to scrollback, in chunks
+ *  never touch the line under terminal cursor, nor what follows
+ */
+void ConsoleEdit::scrollback_trim() {
+    QTextDocument *d = document();
+    int excess = d->blockCount() - scrollback_lines - paged_in;
+    if (scrollback_lines <= 0 || excess < Scrollback::chunk_lines)
+        return;
 
-            QStringList lcap = eseq.capturedTexts();
-            Q_ASSERT(lcap.length() == 9); // match captures in eseq, 0 seems unrelated to paren
+    int keep = out_base() - out_back;
+    QTextBlock b = d->begin();
+    for ( ; excess > 0 && b.next().isValid() && b.next().position() <= keep; --excess, b = b.next())
+        scrollback.append(b);
 
-            // put 'out-of-band' text with current attribute, before changing it
-            instext(text.mid(left, pos1 - left));
+    int removed = b.position();
+    if (removed == 0)
+        return;
 
-            // map sequence to text attributes
-            QFont::Weight w;
-            QBrush c;
-            int skip = lcap[1].length();
-            if (skip) {
-                QString A = lcap[2], B = lcap[3];
-                w = QFont::Normal;
-                c = ANSI2col(B.toInt(), A == "1");
-            }
-            else if (!lcap[6].isNull()) {
-                skip  = 5;
-                w = QFont::Bold;
-                c = ANSI2col(lcap[6].toInt());
-            }
-            else if ((skip = lcap[7].length()) > 0) {
-                w = QFont::Bold;
-                c = ANSI2col(0);
-            }
-            else if (!lcap[8].isNull()) {
-                skip = 3;
-                w = QFont::Normal;
-                c = ANSI2col(lcap[8].toInt());
-            }
-            else {
-                skip = lcap[4].length() + lcap[5].length();
-                w = QFont::Normal;
-                c = ANSI2col(0);
-            }
+    // keep the view still, if the user is reading
+    int top = int(d->documentLayout()->blockBoundingRect(b).top());
 
-            output_text_fmt.setFontWeight(w);
-            output_text_fmt.setForeground(c);
+    QTextCursor c(d);
+    c.setPosition(removed, c.KeepAnchor);
+    c.removeSelectedText();
+    out_shift(0, removed, 0);
+    top_changed();
+    output_undo();
 
-            left = pos = pos1 + skip + 2; // add the SCI
-        }
+    auto s = verticalScrollBar();
+    s->setValue(s->value() - top);
+}
 
-        instext(text.mid(pos));
+/** page in from scrollback when scrolled to top, trim back at bottom
+ */
+void ConsoleEdit::scrolled(int value) {
+    auto s = verticalScrollBar();
+    if (value == s->minimum() && scrollback.lines() > 0)
+        QMetaObject::invokeMethod(this, "scrollback_page", Qt::QueuedConnection);
+    else if (value == s->maximum() && paged_in > 0) {
+        paged_in = 0;
+        scrollback_trim();
+    }
+    if (textCursor().hasSelection())
+        occurrences();
+}
+
+/** bring back the newest chunk of scrollback on top of document
+ */
+void ConsoleEdit::scrollback_page() {
+    auto s = verticalScrollBar();
+    if (s->value() != s->minimum() || scrollback.lines() == 0)
+        return;
+
+    int added = scrollback_restore(1);
+
+    // keep on view the line that was on top
+    s->setValue(int(document()->documentLayout()->blockBoundingRect(document()->findBlock(added)).top()));
+}
+
+/** restore at least <lines> from scrollback, return chars inserted on top
+ */
+int ConsoleEdit::scrollback_restore(int lines) {
+    QTextDocument *d = document();
+    int before = d->characterCount();
+    QTextCursor c(d);
+    while (lines > 0) {
+        // each chunk is older than the one before: goes on top of it
+        c.movePosition(QTextCursor::Start);
+        int n = scrollback.restore(c);
+        if (n == 0)
+            break;
+        paged_in += n;
+        lines -= n;
+    }
+
+    int added = d->characterCount() - before;
+    if (added) {
+        out_shift(0, 0, added);
+        scan_messages(0, added);
+        top_changed();
+        output_undo();
+    }
+    return added;
+}
+
+/** select previous occurrence of text, paging in scrollback if required
+ */
+bool ConsoleEdit::find_history(QString text) {
+    QTextDocument *d = document();
+    QTextCursor c = d->find(text, textCursor(), QTextDocument::FindBackward);
+    if (c.isNull()) {
+        int depth = scrollback.search(text);
+        if (depth == 0)
+            return false;
+        int added = scrollback_restore(depth);
+        c = d->find(text, added, QTextDocument::FindBackward);
+        if (c.isNull())
+            return false;
+    }
+    setTextCursor(c);
+    ensureCursorVisible();
+    return true;
+}
+
+/** positions saved for highlighting are stale, when document top changes
+ */
+void ConsoleEdit::top_changed() {
+    for (auto l : {&paren_overlay, &occurs_overlay, &link_overlay})
+        for (int i = l->size() - 1; i >= 0; --i)
+            if (!l->at(i).cursor.hasSelection())
+                l->removeAt(i);
+    set_overlays();
+}
+
+/** map a parser style to a cached char format
+ */
+const QTextCharFormat &ConsoleEdit::style_format(const ANSI_ESC_SEQ::SGR &sgr) {
+    auto f = style_formats.find(sgr.key());
+    if (f == style_formats.end()) {
+        QTextCharFormat tcf = output_text_fmt;
+        sgr.setStyle(tcf);
+        f = style_formats.insert(sgr.key(), tcf);
+    }
+    return f.value();
+}
+
+/** move decoded engine output into the document
+ *  called once per frame by RepaintScheduler, stop when <msec> are spent
+ */
+bool ConsoleEdit::drain_output(int msec) {
+    QElapsedTimer t;
+    t.start();
+
+    OutputPipe::batch b;
+    bool more = false, any = false;
+    while (!more && pipe->take(b)) {
+        user_output(b);
+        any = true;
+        more = t.elapsed() >= msec;
+    }
+    if (!any)
+        return false;
+
+    output_undo();
+    scrollback_trim();
+
+    // keep following a running goal output
+    if (status == running) {
+        QTextCursor c = textCursor();
+        c.movePosition(c.End);
+        setTextCursor(c);
+        ensureCursorVisible();
+    }
+    return more;
+}
+
+/** output is not undoable: don't keep it twice
+ *  while a line is being edited its history stays, dropped at next prompt
+ */
+void ConsoleEdit::output_undo() {
+    if (status != wait_input)
+        document()->clearUndoRedoStacks();
+}
+
+/** the ring could refill meanwhile from other writers: stop when no progress
+ */
+void ConsoleEdit::flush_output() {
+    for (size_t left = output.size() + pipe->held(); left > 0; ) {
+        pipe->ingest();
+        drain_output(INT_MAX);
+        size_t now = output.size() + pipe->held();
+        if (now >= left)
+            break;
+        left = now;
     }
-    else
-        instext(text);
-#endif
+}
+
+void ConsoleEdit::output_ready() {
+    RepaintScheduler::instance()->post(this);
+}
+
+int ConsoleEdit::frameRate() const {
+    return RepaintScheduler::instance()->rate();
+}
+void ConsoleEdit::setFrameRate(int v) {
+    RepaintScheduler::instance()->setRate(v);
 }
 
 bool ConsoleEdit::match_thread(int thread_id) const {
@@ -655,8 +1183,11 @@ void ConsoleEdit::user_prompt(int threadId, bool tty) {
     Q_ASSERT(thids.contains(threadId));
 
     is_tty = tty;
+    out_back = 0;
 
     Completion::setup();
+    PredicateIndex::instance()->start();
+    DocIndex::instance()->start();
 
     QTextCursor c = textCursor();
     c.movePosition(QTextCursor::End);
@@ -664,6 +1195,8 @@ void ConsoleEdit::user_prompt(int threadId, bool tty) {
     setTextCursor(c);
     ensureCursorVisible();
 
+    // a new input line: what was typed before is not editable anymore
+    document()->clearUndoRedoStacks();
     status = wait_input;
 
     if (commands.count() > 0)
@@ -705,15 +1238,21 @@ bool ConsoleEdit::event(QEvent *event) {
     return ConsoleEditBase::event(event);
 }
 
-/** sense word under cursor for tooltip display
+/** sense word under mouse for tooltip display
+ *  moves within a display frame coalesce: only the last position is served
  */
-bool ConsoleEdit::eventFilter(QObject *, QEvent *event) {
-    if (event->type() == QEvent::MouseMove) {
-        QTextCursor c = cursorForPosition(static_cast<QMouseEvent*>(event)->pos());
-        set_cursor_tip(c);
-        clickable_message_line(c, true);
-    }
-    return false;
+void ConsoleEdit::mouseMoveEvent(QMouseEvent *e) {
+    hover_pos = e->pos();
+    if (!hover_timer.isActive())
+        hover_timer.start(1000 / RepaintScheduler::instance()->rate(), this);
+    ConsoleEditBase::mouseMoveEvent(e);
+}
+
+void ConsoleEdit::hover() {
+    hover_timer.stop();
+    QTextCursor c = cursorForPosition(hover_pos);
+    set_cursor_tip(c);
+    clickable_message_line(c, true);
 }
 
 /** the user identifying label is attached somewhere to parents chain
@@ -748,17 +1287,34 @@ void ConsoleEdit::onCursorPositionChanged() {
         viewport()->setCursor(Qt::IBeamCursor);
     }
 
-    if (pmatched.size()) {
-        pmatched.format_both(c);
-        pmatched = ParenMatching::range();
+    bool had = !paren_overlay.isEmpty();
+    paren_overlay.clear();
+
+    ParenMatching pm(c, fixedPosition);
+    if (pm) {
+        QTextCharFormat f = overlay_format(128);
+        for (int p : {pm.positions.beg, pm.positions.end}) {
+            QTextCursor m(document());
+            m.setPosition(p);
+            m.setPosition(p + 1, m.KeepAnchor);
+            paren_overlay.append(ExtraSelection {m, f});
+        }
     }
+    if (had || pm)
+        set_overlays();
+}
 
-    ParenMatching pm(c);
-    if (pm)
-        (pmatched = pm.positions).format_both(c, pmatched.bold());
+/** a translucent highlight color, readable with any theme
+ */
+QTextCharFormat ConsoleEdit::overlay_format(int alpha) const {
+    QColor c = palette().color(QPalette::Highlight);
+    c.setAlpha(alpha);
+    QTextCharFormat f;
+    f.setBackground(c);
+    return f;
 }
 
-/** check if line content is appropriate, then highlight or open editor on it */
+/** if line is a message with source reference, highlight or open editor on it */
 #ifndef PQCONSOLE_HANDLE_HOOVERING
 
 void ConsoleEdit::clickable_message_line(QTextCursor c, bool highlight) {
@@ -766,48 +1322,70 @@ void ConsoleEdit::clickable_message_line(QTextCursor c, bool highlight) {
     Q_UNUSED(highlight)
 }
 
+void ConsoleEdit::scan_messages(int from, int to) {
+    Q_UNUSED(from)
+    Q_UNUSED(to)
+}
+
 #else
 
+/** the reference was parsed when the line was appended: just test block data
+ *  highlight is an underline overlay, the line format is untouched
+ */
 void ConsoleEdit::clickable_message_line(QTextCursor c, bool highlight) {
 
-    c.movePosition(c.StartOfLine);
-
-    int cposition_ = c.position();
-    QTextCharFormat fposition_ = c.charFormat();
-
-    c.movePosition(c.EndOfLine, c.KeepAnchor);
+    QTextBlock b = c.block();
+    auto data = static_cast<BlockData*>(b.userData());
+    bool link = data && data->is_message();
 
-    QString line = c.selectedText();
-    static QRegularExpression msg("(ERROR|Warning):[ \t]*(([a-zA-Z]:)?[^:]+):([0-9]+)(:([0-9]+))?.*",
-                                  QRegularExpression::CaseInsensitiveOption);
-    auto parts = msg.match(line);
-    if (parts.hasMatch()) {
-        if ( highlight ) {
-            if (cposition != cposition_) {
-                cposition = cposition_;
-                fposition = fposition_;
-                QTextCharFormat f = fposition_;
-                f.setFontUnderline(true);
-                c.setCharFormat(f);
-            }
+    if (highlight) {
+        if (link && !link_overlay.isEmpty() && link_overlay[0].cursor.block() == b)
             return;
-        } else {
-            auto cmd = QString("edit('"+parts.captured(2)+"':"+parts.captured(4));
-            if ( !parts.captured(6).isEmpty() ) {
-                cmd += ":"+parts.captured(6);
-            }
-            cmd += ")";
-            qDebug() << cmd;
-            query_run(cmd);
+        bool had = !link_overlay.isEmpty();
+        link_overlay.clear();
+        if (link) {
+            QTextCursor l(b);
+            l.movePosition(l.EndOfBlock, l.KeepAnchor);
+            QTextCharFormat f;
+            f.setFontUnderline(true);
+            link_overlay.append(ExtraSelection {l, f});
         }
+        if (had || link)
+            set_overlays();
+    }
+    else if (link) {
+        auto cmd = QString("edit('%1':%2").arg(data->msg_file).arg(data->msg_line);
+        if (data->msg_col > 0)
+            cmd += QString(":%1").arg(data->msg_col);
+        cmd += ")";
+        qDebug() << cmd;
+        query_run(cmd);
     }
+}
 
-    if (fposition != QTextCharFormat()) {
-        c.setPosition(cposition);
-        c.movePosition(c.EndOfLine, c.KeepAnchor);
-        c.setCharFormat(fposition);
-        fposition = QTextCharFormat();
-        cposition = -1;
+/** ERROR/Warning lines are recognized once, as appended or paged in
+ *  a line still being written is scanned again with the next output
+ */
+void ConsoleEdit::scan_messages(int from, int to) {
+    static QRegularExpression msg("(ERROR|Warning):[ \t]*(([a-zA-Z]:)?[^:]+):([0-9]+)(:([0-9]+))?.*",
+                                  QRegularExpression::CaseInsensitiveOption);
+    QTextDocument *d = document();
+    QTextBlock b = d->findBlock(from), e = d->findBlock(to);
+    for ( ; b.isValid(); b = b.next()) {
+        QString line = b.text();
+        auto data = static_cast<BlockData*>(b.userData());
+        QRegularExpressionMatch parts;
+        if ((line.contains("error:", Qt::CaseInsensitive) || line.contains("warning:", Qt::CaseInsensitive))
+                && (parts = msg.match(line)).hasMatch()) {
+            data = BlockData::of(b);
+            data->msg_file = parts.captured(2);
+            data->msg_line = parts.captured(4).toInt();
+            data->msg_col = parts.captured(6).toInt();
+        }
+        else if (data)
+            data->msg_line = 0;
+        if (b == e)
+            break;
     }
 }
 #endif
@@ -824,8 +1402,15 @@ void ConsoleEdit::set_cursor_tip(QTextCursor c) {
  */
 void ConsoleEdit::int_request() {
     qDebug() << "int_request" << thids;
-    if (!thids.empty())
+    if (!thids.empty()) {
         PL_thread_raise(thids[0], SIGINT);
+
+        // the reader doesn't hold its lock while serving a query: waking it is quick
+        if (eng)
+            eng->wake();
+        else if (io)
+            io->wake();
+    }
 }
 
 /** serve the user menu issuing the command
@@ -843,18 +1428,22 @@ void ConsoleEdit::onConsoleMenuActionMap(QString action) {
             qDebug() << action << target->status << QTime::currentTime();
             if (target->status == running) {
                 {   SwiPrologEngine::in_thread e;
+                    if (!e)
+                        return;
                     int t = PL_thread_self();
                     Q_ASSERT(!target->thids.contains(t));
-                    target->thids.append(t);
+                    target->bind_thread(t);
                     try {
                         PL_set_prolog_flag("console_thread", PL_INTEGER, t);
                         PlCall(action.toStdWString().data());
-                        for (int c = 0; c < 100; c++)
-                            do_events(10);
+                        // serve GUI requests the action queued, while still bound to target
+                        do_events();
                     } catch(const PlException& e) {
                         qDebug() << CCP(e);
                     }
-                    target->thids.removeLast();
+                    target->unbind_thread(t);
+                    // console_thread flag and whatever the action set are thread local
+                    e.discard();
                 }
                 return;
             }
@@ -868,6 +1457,10 @@ void ConsoleEdit::onConsoleMenuActionMap(QString action) {
 void ConsoleEdit::tty_clear() {
     clear();
     fixedPosition = promptPosition = 0;
+    out_back = 0;
+    scrollback.clear();
+    paged_in = 0;
+    top_changed();
 }
 
 /** issue instancing in GUI thread (cant moveToThread a Widget)
@@ -917,6 +1510,9 @@ void ConsoleEdit::eng_completed() {
         QApplication::postEvent(qApp, new QCloseEvent);
     }
     else if (io) {
+        // the thread id could be reused before the console is gone
+        foreach (int id, QList<int>(thids))
+            unbind_thread(id);
         if (auto mw = find_parent<pqMainWindow>(this))
             mw->remConsole(this);
     }
@@ -940,32 +1536,30 @@ void ConsoleEdit::query_run(QString module, QString call) {
         query_run(module + ":" + call);
 }
 
-ConsoleEdit::exec_sync::exec_sync(int timeout_ms) {
-    Q_UNUSED(timeout_ms);
-    stop_ = QThread::currentThread();
-    go_ = 0;
+/** from GUI thread run directly, as a direct signal would do
+ */
+void ConsoleEdit::exec_func(pfunc f, pfunc dropped) {
+    if (QThread::currentThread() == thread())
+        f();
+    else
+        GuiCommands::instance()->post(this, std::move(f), std::move(dropped));
 }
-void ConsoleEdit::exec_sync::stop() {
-    Q_ASSERT(QThread::currentThread() == stop_);
-    for ( ; ; ) {
-        {   QMutexLocker lk(&sync);
-            if (go_)
-                break;
-        }
-        SwiPrologEngine::msleep(10);
+
+/** block until go() or timeout - also fine if go() already ran, as from GUI thread
+ */
+ConsoleEdit::exec_sync::exec_sync(int timeout_ms)
+    : timeout_ms(timeout_ms)
+{
+}
+bool ConsoleEdit::exec_sync::stop() {
+    if (timeout_ms < 0) {
+        sync.acquire();
+        return true;
     }
-    //Q_ASSERT(go_ && go_ != stop_);
+    return sync.tryAcquire(1, timeout_ms);
 }
 void ConsoleEdit::exec_sync::go() {
-    Q_ASSERT(go_ == 0);
-    Q_ASSERT(stop_ != 0);
-    auto t = QThread::currentThread();
-    if (stop_ != t) {
-        QMutexLocker lk(&sync);
-        go_ = t;
-    }
-    else
-        go_ = t;
+    sync.release();
 }
 
 void ConsoleEdit::setSource(const QUrl &name) {
@@ -983,40 +1577,37 @@ void ConsoleEdit::html_write(QString html) {
 
 void ConsoleEdit::selectionChanged()
 {
-    if (sel_check_timing.isValid()) {
-        if (sel_check_timing.elapsed() < 100)
-            return;
-        sel_check_timing.restart();
-    }
-    else
-        sel_check_timing.start();
-
-    blockSig bs(this);
-
-    foreach (ExtraSelection s, extraSelections())
-        s.cursor.setCharFormat(s.format);
-    extraSelections().clear();
+    occurrences();
+}
 
-    QTextCursor c = textCursor();
-    if (c.hasSelection()) {
-        QString csel = c.selectedText();
-        QList<ExtraSelection> lsel;
-        QTextCharFormat bold = ParenMatching::range::bold();
-
-        QTextCursor cfirst = cursorForPosition(QPoint(0, 0));
-        if (!cfirst.isNull()) {
-            while (c.block().position() > cfirst.block().position())
-                c.movePosition(c.Up);
-            c.movePosition(c.Up);
-            for ( ; ; ) {
-                c = document()->find(csel, c, QTextDocument::FindCaseSensitively);
-                if (c.isNull() || !c.block().isVisible())
-                    break;
-                lsel.append(ExtraSelection {c, c.blockCharFormat()});
-                c.setCharFormat(bold);
+/** mark occurrences of a single line selection, only on lines in view
+ *  also called on scroll, as they change
+ */
+void ConsoleEdit::occurrences() {
+    bool had = !occurs_overlay.isEmpty();
+    occurs_overlay.clear();
+
+    QString csel = textCursor().selectedText();
+    if (!csel.trimmed().isEmpty() && !csel.contains(QChar::ParagraphSeparator)) {
+        QTextCharFormat f = overlay_format(64);
+        QTextBlock
+            b = cursorForPosition(QPoint(0, 0)).block(),
+            e = cursorForPosition(QPoint(viewport()->width(), viewport()->height())).block();
+        for ( ; b.isValid(); b = b.next()) {
+            if (b.isVisible()) {
+                QString t = b.text();
+                for (int i = 0; (i = t.indexOf(csel, i)) >= 0; i += csel.length()) {
+                    QTextCursor m(b);
+                    m.setPosition(b.position() + i);
+                    m.setPosition(b.position() + i + csel.length(), m.KeepAnchor);
+                    occurs_overlay.append(ExtraSelection {m, f});
+                }
             }
+            if (b == e)
+                break;
         }
-
-        setExtraSelections(lsel);
     }
+
+    if (had || !occurs_overlay.isEmpty())
+        set_overlays();
 }
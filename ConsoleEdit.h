@@ -51,18 +51,64 @@
 #include "SwiPrologEngine.h"
 #include "Completion.h"
 #include "ParenMatching.h"
+#include "OutputRing.h"
+#include "OutputPipe.h"
+#include "Scrollback.h"
+#include "QueryExecutor.h"
 
 #include <QElapsedTimer>
+#include <QBasicTimer>
 #include <QShortcut>
+#include <QSemaphore>
+#include <exception>
+#include <stdexcept>
+#include <future>
+#include <memory>
 
 class Swipl_IO;
 
+/** hold the outcome of a function run in GUI thread for the caller
+ *  void needs its own specialization
+ */
+template<typename R> struct gui_result {
+    R value;
+    std::exception_ptr error;
+    template<typename F> void run(F &f) {
+        try { value = f(); } catch(...) { error = std::current_exception(); }
+    }
+    R get() {
+        if (error)
+            std::rethrow_exception(error);
+        return value;
+    }
+    template<typename F> static void run(std::promise<R> &p, F &f) {
+        try { p.set_value(f()); } catch(...) { p.set_exception(std::current_exception()); }
+    }
+};
+template<> struct gui_result<void> {
+    std::exception_ptr error;
+    template<typename F> void run(F &f) {
+        try { f(); } catch(...) { error = std::current_exception(); }
+    }
+    void get() {
+        if (error)
+            std::rethrow_exception(error);
+    }
+    template<typename F> static void run(std::promise<void> &p, F &f) {
+        try { f(); p.set_value(); } catch(...) { p.set_exception(std::current_exception()); }
+    }
+};
+
 /** client side of command line interface
   * run in GUI thread, sync using SwiPrologEngine interface
   */
 class PQCONSOLESHARED_EXPORT ConsoleEdit : public ConsoleEditBase {
     Q_OBJECT
     Q_PROPERTY(int updateRefreshRate READ updateRefreshRate WRITE setUpdateRefreshRate)
+    Q_PROPERTY(int frameRate READ frameRate WRITE setFrameRate)
+    Q_PROPERTY(int outputBacklog READ outputBacklog WRITE setOutputBacklog)
+    Q_PROPERTY(int scrollbackLines READ scrollbackLines WRITE setScrollbackLines)
+    Q_PROPERTY(int scrollbackMemory READ scrollbackMemory WRITE setScrollbackMemory)
 
 public:
 
@@ -75,6 +121,8 @@ public:
     /** create in prolog thread - from win_open_console(), add to tabbed interface */
     ConsoleEdit(Swipl_IO* io);
 
+    ~ConsoleEdit();
+
     /** push command on queue */
     bool command(QString text);
 
@@ -90,32 +138,106 @@ public:
     int thread_id() const { return thids[0]; }
     void add_thread(int id);
 
+    /** associate/release a Prolog thread, keeping the registry in sync */
+    void bind_thread(int id);
+    void unbind_thread(int id);
+
+    /** console associated with Prolog thread, 0 if none - callable from any thread */
+    static ConsoleEdit *by_thread(int thread_id);
+
     /** remove all text */
     void tty_clear();
 
-    /** make public property, then available on Prolog side */
+    /** show all output queued so far, whatever the frame pacing
+     *  commands changing the document must not overtake earlier output
+     */
+    void flush_output();
+
+    /** make public property, then available on Prolog side
+     *  deprecated: output is now displayed once per frame, see frameRate
+     */
     int updateRefreshRate() const { return update_refresh_rate; }
     void setUpdateRefreshRate(int v) { update_refresh_rate = v; }
 
+    /** frames per second of output display, shared by all consoles */
+    int frameRate() const;
+    void setFrameRate(int v);
+
+    /** bytes of undisplayed output a writer can queue before being suspended */
+    int outputBacklog() const { return output_backlog; }
+    void setOutputBacklog(int v) { output_backlog = v; pipe->set_limit(v > 0 ? size_t(v) : output.capacity()); }
+
+    /** lines kept in document, older ones move to scrollback - 0 to keep all */
+    int scrollbackLines() const { return scrollback_lines; }
+    void setScrollbackLines(int v) { scrollback_lines = v; }
+
+    /** MB of scrollback kept in memory, older lines spill to disk - 0 to never spill */
+    int scrollbackMemory() const { return int(scrollback.memoryLimit() >> 20); }
+    void setScrollbackMemory(int v) { scrollback.setMemoryLimit(qint64(v) << 20); }
+
+    /** select previous occurrence of text, in document or scrollback */
+    bool find_history(QString text);
+
     /** create a new console, bound to calling thread */
     void new_console(Swipl_IO *e, QString title);
 
     /** closeEvent only called for top level widgets */
     bool can_close();
 
-    /** 4. attempt to run generic code inter threads */
-    void exec_func(pfunc f) { emit sig_run_function(f); }
+    /** run generic code in GUI thread, batched with other threads requests
+     *  <dropped> runs instead, if the console is destroyed before f could run
+     */
+    void exec_func(pfunc f, pfunc dropped = pfunc());
+
+    /** run f in GUI thread, don't wait for it */
+    void gui_post(pfunc f) { exec_func(f); }
 
-    /** 5. helper syncronization for modal loop */
+    /** run f in GUI thread and return its result, blocking the caller meanwhile
+     *  called from GUI thread, f runs directly - exceptions are rethrown to caller
+     */
+    template<typename R, typename F>
+    R gui_call(F f) {
+        if (QThread::currentThread() == thread())
+            return f();
+        gui_result<R> r;
+        QSemaphore done;
+        exec_func([&]() { r.run(f); done.release(); },
+                  [&]() { r.error = gui_gone(); done.release(); });
+        done.acquire();
+        return r.get();
+    }
+
+    /** run f in GUI thread, the result will be available from the future */
+    template<typename R, typename F>
+    std::future<R> gui_async(F f) {
+        auto p = std::make_shared<std::promise<R>>();
+        auto r = p->get_future();
+        if (QThread::currentThread() == thread())
+            gui_result<R>::run(*p, f);
+        else
+            exec_func([=]() mutable { gui_result<R>::run(*p, f); },
+                      [=]() { p->set_exception(gui_gone()); });
+        return r;
+    }
+
+    /** the error a caller gets when the console went away before its call ran */
+    static std::exception_ptr gui_gone() {
+        return std::make_exception_ptr(std::runtime_error("console destroyed"));
+    }
+
+    /** 5. helper syncronization for modal loop
+     *  stop() waits for go() up to timeout_ms - negative waits forever
+     */
     struct PQCONSOLESHARED_EXPORT exec_sync {
         exec_sync(int timeout_ms = 100);
 
-        void stop();
+        /** false on timeout */
+        bool stop();
         void go();
 
     private:
-        QThread *stop_, *go_;
-        QMutex sync;
+        QSemaphore sync;
+        int timeout_ms;
     };
 
     /** give access to rl_... predicates */
@@ -159,9 +281,24 @@ protected:
     /** support completion */
     virtual void focusInEvent(QFocusEvent *e);
 
+    /** resume output display parked while hidden */
+    virtual void showEvent(QShowEvent *e);
+
     /** filter out insertion when cursor is not in editable position */
     virtual void insertFromMimeData(const QMimeData *source);
 
+    /** large paste goes straight to the engine input, in chunks */
+    enum { paste_stream_limit = 64 * 1024 };
+    QString paste_text;
+    int paste_off;
+    QBasicTimer paste_timer;
+    void paste_start(QString text);
+    void paste_feed();
+    void paste_stop();
+
+    /** serve <paste_timer>, <completion_timer>, <hover_timer> */
+    virtual void timerEvent(QTimerEvent *e);
+
     /** support SWI... exec thread console creation */
     struct req_new_console : public QEvent {
         Swipl_IO *iop;
@@ -173,8 +310,11 @@ protected:
     /** handle tooltip placing */
     virtual bool event(QEvent *event);
 
-    /** sense word under cursor for tooltip display */
-    virtual bool eventFilter(QObject *, QEvent *event);
+    /** sense word under mouse for tooltip display, at most once per frame */
+    virtual void mouseMoveEvent(QMouseEvent *e);
+    QBasicTimer hover_timer;
+    QPoint hover_pos;
+    void hover();
 
     /** output/input text attributes */
     QTextCharFormat output_text_fmt, input_text_fmt;
@@ -191,21 +331,91 @@ protected:
     int history_next;
     QString history_spare;
 
-    /** count output before setting cursor at end */
-    int count_output;
+    /** engine output, filled by writer threads, drained by <pipe> */
+    OutputRing output;
 
-    /** interval on count_output, determine how often to force output flushing */
+    /** decode and parse off the GUI thread, living on OutputPipe::worker() */
+    OutputPipe *pipe;
+
+    /** throttle writers beyond this, 0 to only limit on ring capacity */
+    int output_backlog;
+
+    /** kept for updateRefreshRate compatibility, unused */
     int update_refresh_rate;
 
+    /** append a batch of decoded output */
+    void user_output(const OutputPipe::batch &b);
+
+    /** drop undo history of output, unless input is being edited */
+    void output_undo();
+
+    /** append batches ready from <pipe> for about <msec>, true if more are left */
+    bool drain_output(int msec);
+
+    /** writers are waiting: serve even if hidden */
+    bool output_blocked() const { return pipe->full(); }
+
+    /** char formats built from parser styles, reset on colors change */
+    QHash<quint64, QTextCharFormat> style_formats;
+    const QTextCharFormat &style_format(const ANSI_ESC_SEQ::SGR &sgr);
+
+    /** terminal cursor, as distance back from output append position */
+    int out_back;
+    int out_base() const;
+    void out_shift(int at, int removed, int added);
+    void out_replace(QTextCursor &c, int from, int to, QString text, const QTextCharFormat &fmt);
+    QString out_overwrite(QTextCursor &c, QString text, const QTextCharFormat &fmt);
+    void out_control(QTextCursor &c, const ANSI_ESC_SEQ::run &r, const QTextCharFormat &fmt);
+
+    /** history beyond the live window of <scrollback_lines> */
+    Scrollback scrollback;
+    int scrollback_lines;
+
+    /** lines the user brought back scrolling up, kept until back at bottom */
+    int paged_in;
+
+    /** move excess top lines to scrollback */
+    void scrollback_trim();
+
+    /** restore at least <lines> from scrollback, return chars inserted on top */
+    int scrollback_restore(int lines);
+
+    /** drop overlays collapsed by removal of text on top */
+    void top_changed();
+
     /** autocompletion - today not context sensitive */
     /** will eventually become with help from the kernel */
     typedef QCompleter t_Completion;
     t_Completion *preds;
     QStringList lmodules;
 
-    /** factorize code, attempt to get visual clue from QCompleter */
-    void compinit(QTextCursor c);
-    void compinit2(QTextCursor c);
+    /** completion runs on QueryExecutor, off the GUI thread
+     *  requests are debounced while typing, and outdated ones are cancelled
+     */
+    enum { completion_debounce = 80 };
+    QBasicTimer completion_timer;
+    QueryPtr completion_query;
+    int completion_gen;
+    bool completion_described, completion_refresh;
+
+    /** request completion at cursor after <delay> msecs
+     *  <described> lists predicates with their description
+     *  <refresh> updates the popup only if still open
+     */
+    void compinit(bool described, int delay = 0, bool refresh = false);
+
+    /** submit the pending request, for text at cursor now */
+    void completion_start();
+
+    /** described completion from PredicateIndex, ranked by fuzzy match, without calling Prolog */
+    enum { completion_max = 1000 };
+    void completion_index(bool refresh);
+
+    /** fill and show the popup, attempt to get visual clue from QCompleter
+     *  <describe> looks up descriptions of bare atoms in <strings>
+     *  <ranked> strings are shown in order, unfiltered
+     */
+    void completion_show(QString prefix, QStringList strings, bool describe, bool refresh, bool ranked = false);
 
     /** associated thread id (see PL_thread_self()) */
     QList<int> thids;
@@ -227,6 +437,8 @@ protected:
     // while solving inter threads problems...
     friend class SwiPrologEngine;
     friend class Swipl_IO;
+    friend struct FlushOutputEvents;
+    friend class RepaintScheduler;
 
     /** need to sense the processor type to execute code
      *  bypass IO based execution, direct calling
@@ -234,27 +446,26 @@ protected:
     void query_run(QString call);
     void query_run(QString module, QString call);
 
-    /** check if line content is appropriate, then highlight or open editor on it */
+    /** if line is a message with source reference, highlight or open editor on it */
     void clickable_message_line(QTextCursor c, bool highlight);
-#ifdef PQCONSOLE_HANDLE_HOOVERING
-    int cposition;
-    QTextCharFormat fposition;
-#endif
+
+    /** store source references of messages in lines from..to, see BlockData */
+    void scan_messages(int from, int to);
 
     /** sense URL */
     virtual void setSource(const QUrl & name);
 
-    /** relax selection check requirement */
-    QElapsedTimer sel_check_timing;
+    /** highlights drawn over the text at paint time, the document is untouched
+     *  bracket match, and occurrences of selected text on visible lines
+     */
+    QList<ExtraSelection> paren_overlay, occurs_overlay, link_overlay;
+    void set_overlays() { setExtraSelections(paren_overlay + occurs_overlay + link_overlay); }
+    QTextCharFormat overlay_format(int alpha) const;
+    void occurrences();
 
 protected:
     QShortcut *pasteQuoted = nullptr;
 
-protected:
-
-    /** keep last matched pair */
-    ParenMatching::range pmatched;
-
 public slots:
 
     /** display different cursor where editing available */
@@ -264,13 +475,17 @@ public slots:
     void onConsoleMenuAction();
     void onConsoleMenuActionMap(QString action);
 
-    /** 2. attempt to run generic code inter threads */
+    /** deprecated: kept for library clients, use exec_func() */
     void run_function(pfunc f) { f(); }
 
 protected slots:
 
-    /** send text to output */
-    void user_output(QString text);
+    /** <pipe> has batches ready: queue on RepaintScheduler */
+    void output_ready();
+
+    /** page in from scrollback when scrolled to top, trim back at bottom */
+    void scrolled(int value);
+    void scrollback_page();
 
     /** issue an input request */
     void user_prompt(int threadId, bool tty);
@@ -295,7 +510,7 @@ signals:
     /** issued to serve prompt */
     void user_input(QString);
 
-    /** 3. attempt to run generic code inter threads */
+    /** deprecated: kept for library clients, use exec_func() */
     void sig_run_function(pfunc f);
 };
 
@@ -0,0 +1,237 @@
+/*  Part of SWI-Prolog interface to Qt
+
+    Author:        SWI-Prolog contributors
+    WWW:           https://www.swi-prolog.org
+    Copyright (c)  2026, SWI-Prolog contributors
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions
+    are met:
+
+    1. Redistributions of source code must retain the above copyright
+       notice, this list of conditions and the following disclaimer.
+
+    2. Redistributions in binary form must reproduce the above copyright
+       notice, this list of conditions and the following disclaimer in
+       the documentation and/or other materials provided with the
+       distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+    FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+    COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+    INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+    BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+    LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+    ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#include "DocIndex.h"
+#include "QueryExecutor.h"
+#include "SwiPrologEngine.h"
+#include "PREDICATE.h"
+#include <QDir>
+#include <QDebug>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <algorithm>
+#include <cstring>
+
+static const char magic[8] = {'P','Q','D','O','C','I','X','1'};
+
+/** normalize man_index/5 and doc_comment/4 objects to e(Name, Arity, Summary)
+ *  DCG rules count their two hidden arguments
+ */
+static const char *enumerate_goal =
+    "E = e(N, A, S),"
+    "( catch(man_index(O, S0, _, _, _), _, fail)"
+    "; catch(doc_comment(O, _, S0, _), _, fail)"
+    "),"
+    "( O = _:PI -> true ; PI = O ),"
+    "( PI = N/A -> true ; PI = N//A0, integer(A0), A is A0 + 2 ),"
+    "atom(N), integer(A),"
+    "( string(S0) -> S = S0 ; atom(S0) -> atom_string(S0, S) ; S = \"\" )";
+
+DocIndex *DocIndex::instance() {
+    static DocIndex *x = new DocIndex;
+    return x;
+}
+
+/** a cache for each Prolog version, as the manual changes with it
+ */
+QString DocIndex::cache_path() {
+    QString dir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+    return QDir(dir).filePath(QString("docindex-%1.bin").arg(PLVERSION));
+}
+
+/** check sizes before trusting offsets, the file could be truncated
+ */
+bool DocIndex::table::attach(const uchar *data, qint64 size) {
+    if (size < qint64(sizeof(header)))
+        return false;
+    const header *h = reinterpret_cast<const header*>(data);
+    if (memcmp(h->magic, magic, sizeof magic))
+        return false;
+    qint64 need = qint64(sizeof(header)) + qint64(h->count) * sizeof(record) + qint64(h->pool) * sizeof(QChar);
+    if (size < need)
+        return false;
+    count = h->count;
+    records = reinterpret_cast<const record*>(data + sizeof(header));
+    pool = reinterpret_cast<const QChar*>(records + count);
+    for (quint32 i = 0; i < count; ++i) {
+        const record &r = records[i];
+        if (quint64(r.name) + r.name_len > h->pool || quint64(r.summary) + r.summary_len > h->pool)
+            return false;
+    }
+    return true;
+}
+
+const DocIndex::record *DocIndex::table::find(QStringView name) const {
+    auto lt = [this](const record &r, QStringView n) { return this->name(r).compare(n) < 0; };
+    const record *r = std::lower_bound(records, records + count, name, lt);
+    return r != records + count && this->name(*r) == name ? r : nullptr;
+}
+
+DocIndex::tab DocIndex::snapshot() const {
+    QMutexLocker lk(&lock);
+    return current;
+}
+
+bool DocIndex::ready() const {
+    return !snapshot().isNull();
+}
+
+QList<DocIndex::doc> DocIndex::lookup(QStringView name) const {
+    QList<doc> l;
+    if (tab t = snapshot())
+        if (const record *r = t->find(name))
+            for (const record *e = t->records + t->count; r != e && t->name(*r) == name; ++r)
+                l.append(doc {name.toString(), r->arity, t->str(r->summary, r->summary_len).toString()});
+    return l;
+}
+
+QString DocIndex::summary(QStringView name, int arity) const {
+    if (tab t = snapshot())
+        if (const record *r = t->find(name))
+            for (const record *e = t->records + t->count; r != e && t->name(*r) == name; ++r)
+                if (r->arity == arity)
+                    return t->str(r->summary, r->summary_len).toString();
+    return QString();
+}
+
+/** the cache is mapped in GUI thread: it's just a validation pass
+ *  then refreshed anyway, to pick up pldoc of code loaded meanwhile
+ */
+void DocIndex::start() {
+    if (started.exchange(true))
+        return;
+
+    auto t = new table;
+    t->file.setFileName(cache_path());
+    if (t->file.open(QIODevice::ReadOnly)) {
+        qint64 size = t->file.size();
+        const uchar *data = t->file.map(0, size);
+        if (data && t->attach(data, size)) {
+            QMutexLocker lk(&lock);
+            current = tab(t);
+            t = 0;
+        }
+    }
+    delete t;
+
+    QueryExecutor::instance()->submit([this]() { build(); }, QueryExecutor::Background);
+}
+
+void DocIndex::build() {
+    struct item {
+        QString name;
+        int arity;
+        QString summary;
+        bool operator<(const item &o) const {
+            int c = name.compare(o.name);
+            return c < 0 || (c == 0 && arity < o.arity);
+        }
+    };
+    QVector<item> items;
+
+    for (auto lib : {"use_module(library(pldoc/man_index))", "use_module(library(pldoc/doc_process))"})
+        try {
+            PlCall(lib);
+        }
+        catch(const PlException& e) {
+            qDebug() << CCP(e);
+        }
+
+    try {
+        PlTerm_var goal, vars, e, nv;
+        SwiPrologEngine::parse_goal(enumerate_goal, goal, vars);
+        for (PlTerm_tail t(vars); t.next(nv); )
+            if (t2w(nv[1]) == "E")
+                PlCheckFail(e.unify_term(nv[2]));
+        PlQuery q("call", PlTermv(goal));
+        while (q.next_solution())
+            items.append(item {t2w(e[1]), e[2].as_int(), t2w(e[3]).simplified()});
+    }
+    catch(const PlException& ex) {
+        qDebug() << CCP(ex);
+        return;
+    }
+
+    // the manual comes first: keep its summary for repeated name/arity
+    std::stable_sort(items.begin(), items.end());
+    auto last = std::unique(items.begin(), items.end(), [](const item &a, const item &b) {
+        return a.arity == b.arity && a.name == b.name;
+    });
+    items.erase(last, items.end());
+
+    QString pool;
+    QVector<record> records;
+    records.reserve(items.size());
+    for (const item &i : items) {
+        record r;
+        if (!records.isEmpty() && i.name == QStringView(pool).mid(records.last().name, records.last().name_len)) {
+            r.name = records.last().name;
+        } else {
+            r.name = quint32(pool.size());
+            pool += i.name;
+        }
+        r.name_len = quint32(i.name.size());
+        r.summary = quint32(pool.size());
+        r.summary_len = quint32(i.summary.size());
+        r.arity = i.arity;
+        pool += i.summary;
+        records.append(r);
+    }
+
+    header h;
+    memcpy(h.magic, magic, sizeof magic);
+    h.count = quint32(records.size());
+    h.pool = quint32(pool.size());
+
+    auto t = new table;
+    t->bytes.append(reinterpret_cast<const char*>(&h), sizeof h);
+    t->bytes.append(reinterpret_cast<const char*>(records.constData()), records.size() * int(sizeof(record)));
+    t->bytes.append(reinterpret_cast<const char*>(pool.constData()), pool.size() * int(sizeof(QChar)));
+    if (!t->attach(reinterpret_cast<const uchar*>(t->bytes.constData()), t->bytes.size())) {
+        delete t;
+        return;
+    }
+
+    tab fresh(t);
+    {   QMutexLocker lk(&lock);
+        current = fresh;
+    }
+
+    // replacing a file still mapped can fail on some systems: next session will retry
+    QDir().mkpath(QFileInfo(cache_path()).absolutePath());
+    QSaveFile f(cache_path());
+    if (!f.open(QIODevice::WriteOnly) || f.write(fresh->bytes) != fresh->bytes.size() || !f.commit())
+        qDebug() << "docindex cache:" << f.errorString();
+}
@@ -0,0 +1,123 @@
+/*  Part of SWI-Prolog interface to Qt
+
+    Author:        SWI-Prolog contributors
+    WWW:           https://www.swi-prolog.org
+    Copyright (c)  2026, SWI-Prolog contributors
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions
+    are met:
+
+    1. Redistributions of source code must retain the above copyright
+       notice, this list of conditions and the following disclaimer.
+
+    2. Redistributions in binary form must reproduce the above copyright
+       notice, this list of conditions and the following disclaimer in
+       the documentation and/or other materials provided with the
+       distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+    FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+    COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+    INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+    BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+    LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+    ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#ifndef DOCINDEX_H
+#define DOCINDEX_H
+
+#include "pqConsole_global.h"
+
+#include <QFile>
+#include <QMutex>
+#include <QString>
+#include <QStringView>
+#include <QSharedPointer>
+#include <atomic>
+
+/** one line summaries of predicates, from the manual and pldoc
+ *
+ *  Built in background with man_index/5 and doc_comment/4, and saved
+ *  to a cache file: next sessions memory map it at startup, so tooltips
+ *  and signature completion are lookups available before Prolog is
+ *  queried, and the GUI thread never calls Prolog for them.
+ *  The file holds a header, fixed size records sorted by name and
+ *  arity, then the UTF-16 pool of names and summaries.
+ */
+class PQCONSOLESHARED_EXPORT DocIndex {
+public:
+
+    struct doc {
+        QString name;
+        int arity;
+        QString summary;
+    };
+
+    static DocIndex *instance();
+
+    /** map the cache if available, and refresh it in background, once */
+    void start();
+
+    /** false until cache mapped or first build completed */
+    bool ready() const;
+
+    /** all documented arities of name */
+    QList<doc> lookup(QStringView name) const;
+
+    /** summary of name/arity, empty if not documented */
+    QString summary(QStringView name, int arity) const;
+
+private:
+
+    DocIndex() : started(false) {}
+
+    struct header {
+        char magic[8];
+        quint32 count;
+        quint32 pool;
+    };
+    struct record {
+        quint32 name, name_len;
+        quint32 summary, summary_len;
+        qint32 arity;
+    };
+
+    /** a validated view on the index bytes, owning them or their mapping */
+    struct table {
+        QByteArray bytes;
+        QFile file;
+        const record *records;
+        const QChar *pool;
+        quint32 count;
+
+        bool attach(const uchar *data, qint64 size);
+        QStringView str(quint32 off, quint32 len) const { return QStringView(pool + off, len); }
+        QStringView name(const record &r) const { return str(r.name, r.name_len); }
+
+        /** first record named <name> */
+        const record *find(QStringView name) const;
+    };
+    typedef QSharedPointer<const table> tab;
+
+    std::atomic<bool> started;
+    mutable QMutex lock;
+    tab current;
+
+    tab snapshot() const;
+
+    static QString cache_path();
+
+    /** with an engine attached: collect, serialize, install and save */
+    void build();
+};
+
+#endif // DOCINDEX_H
@@ -33,33 +33,59 @@
 
 #include "FlushOutputEvents.h"
 #include "ConsoleEdit.h"
-#include "do_events.h"
 
-#include <QDebug>
-#include "PREDICATE.h"
-
-FlushOutputEvents::FlushOutputEvents(ConsoleEdit *target, int msec_delta_refresh)
-    : target(target),
-      msec_delta_refresh(msec_delta_refresh)
+FlushOutputEvents::FlushOutputEvents(ConsoleEdit *target)
+    : target(target)
 {
-    measure_calls.start();
 }
 
+/** the console has been notified already by write(), and repeated
+ *  requests coalesce there: only throttle a writer outpacing the GUI
+ *  backlog counts bytes in the ring and in batches the GUI hasn't taken yet
+ */
 void FlushOutputEvents::flush() {
-    if (measure_calls.elapsed() >= msec_delta_refresh) {
-
-        ConsoleEdit::exec_sync s;
+    OutputRing &r = target->output;
+    OutputPipe *p = target->pipe;
+    size_t limit = size_t(qMax(target->outputBacklog(), 0));
+    if (!limit || QThread::currentThread() == target->thread())
+        return;
+    for (size_t held; r.size() + (held = p->held()) > limit; )
+        r.wait_below(limit - qMin(held, limit));
+}
 
-        target->exec_func([&]() {
-            QTextCursor c = target->textCursor();
-            c.movePosition(c.End);
-            target->setTextCursor(c);
-            target->ensureCursorVisible();
-            do_events();
-            s.go();
-        });
-        s.stop();
+/** append to the ring, waking up the ingest worker once per batch
+ *  when the ring is full, wait for the GUI to make room
+ *  a write is atomic: <producer> is held while waiting, and the GUI,
+ *  which can't wait for itself, drains until it gets it
+ */
+void FlushOutputEvents::write(const char *buf, size_t len) {
+    OutputRing &r = target->output;
+    bool gui = QThread::currentThread() == target->thread();
+    if (gui)
+        while (!r.producer.tryLock()) {
+            // some writer is waiting for us: make room in place
+            target->pipe->ingest();
+            target->drain_output(16);
+            QThread::yieldCurrentThread();
+        }
+    else
+        r.producer.lock();
 
-        measure_calls.restart();
+    for ( ; ; ) {
+        size_t n = r.write(buf, len);
+        buf += n;
+        len -= n;
+        if (r.arm())
+            QMetaObject::invokeMethod(target->pipe, "ingest", Qt::QueuedConnection);
+        if (!len)
+            break;
+        if (gui) {
+            // the GUI can't wait for itself: make room in place
+            target->pipe->ingest();
+            target->drain_output(16);
+        }
+        else
+            r.wait_below(r.capacity() - qMin(len, r.capacity() / 2));
     }
+    r.producer.unlock();
 }
@@ -35,7 +35,6 @@
 #define FLUSHOUTPUTEVENTS_H
 
 #include "pqConsole_global.h"
-#include <QElapsedTimer>
 #include <QThread>
 class ConsoleEdit;
 
@@ -43,12 +42,17 @@ class ConsoleEdit;
  */
 struct PQCONSOLESHARED_EXPORT FlushOutputEvents {
 
-    FlushOutputEvents(ConsoleEdit *target = 0, int msec_delta_refresh = 10);
+    FlushOutputEvents(ConsoleEdit *target = 0);
+
+    /** request display of queued output, don't wait for it
+     *  block only while the console backlog exceeds its limit
+     */
     void flush();
 
+    /** queue raw UTF-8 on target console output ring */
+    void write(const char *buf, size_t len);
+
     ConsoleEdit *target;
-    QElapsedTimer measure_calls;
-    int msec_delta_refresh;
 };
 
 #endif // FLUSHOUTPUTEVENTS_H
@@ -0,0 +1,112 @@
+/*  Part of SWI-Prolog interface to Qt
+
+    Author:        SWI-Prolog contributors
+    WWW:           https://www.swi-prolog.org
+    Copyright (c)  2026, SWI-Prolog contributors
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions
+    are met:
+
+    1. Redistributions of source code must retain the above copyright
+       notice, this list of conditions and the following disclaimer.
+
+    2. Redistributions in binary form must reproduce the above copyright
+       notice, this list of conditions and the following disclaimer in
+       the documentation and/or other materials provided with the
+       distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+    FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+    COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+    INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+    BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+    LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+    ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#include "FuzzyMatch.h"
+
+FuzzyMatch::FuzzyMatch(QStringView pattern)
+    : pat(pattern.toString().toLower()),
+      bits(mask(pattern))
+{
+}
+
+/** a bit for each of a-z, 0-9 and _, one for anything else
+ */
+quint64 FuzzyMatch::mask(QStringView s) {
+    quint64 m = 0;
+    for (QChar c : s) {
+        ushort u = c.unicode();
+        if (u >= 'A' && u <= 'Z')
+            u += 'a' - 'A';
+        if (u >= 'a' && u <= 'z')
+            m |= quint64(1) << (u - 'a');
+        else if (u >= '0' && u <= '9')
+            m |= quint64(1) << (26 + u - '0');
+        else if (u == '_')
+            m |= quint64(1) << 36;
+        else
+            m |= quint64(1) << 37;
+    }
+    return m;
+}
+
+/** greedy leftmost match, preferring a boundary occurrence
+ *  of the current char when one comes before the next pattern char
+ */
+int FuzzyMatch::score(QStringView s) const {
+    int n = s.size(), m = pat.size();
+    if (m == 0)
+        return 0;
+    if (m > n)
+        return no_match;
+
+    auto boundary = [&](int i) {
+        return i == 0 || s[i - 1] == '_' || (s[i].isUpper() && s[i - 1].isLower());
+    };
+    // pattern from j still matches in s from i
+    auto rest = [&](int j, int i) {
+        for ( ; j < m && i < n; ++i)
+            if (s[i].toLower() == pat[j])
+                ++j;
+        return j == m;
+    };
+
+    int total = 0, last = -1, i = 0;
+    for (int j = 0; j < m; ++j) {
+        QChar p = pat[j];
+        while (i < n && s[i].toLower() != p)
+            ++i;
+        if (i == n)
+            return no_match;
+        // a boundary match a bit further is worth more than a consecutive one here
+        if (!boundary(i) && last != i - 1)
+            for (int k = i + 1; k < n && k < i + 16; ++k)
+                if (s[k].toLower() == p && boundary(k) && rest(j + 1, k + 1)) {
+                    i = k;
+                    break;
+                }
+
+        int bonus = 1;
+        if (i == 0)
+            bonus += 8;
+        else if (boundary(i))
+            bonus += 6;
+        if (last == i - 1)
+            bonus += 4;
+        else if (last >= 0)
+            total -= qMin(i - last - 1, 3);
+        total += bonus;
+        last = i++;
+    }
+    return total - (n - m) / 4;
+}
@@ -0,0 +1,76 @@
+/*  Part of SWI-Prolog interface to Qt
+
+    Author:        SWI-Prolog contributors
+    WWW:           https://www.swi-prolog.org
+    Copyright (c)  2026, SWI-Prolog contributors
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions
+    are met:
+
+    1. Redistributions of source code must retain the above copyright
+       notice, this list of conditions and the following disclaimer.
+
+    2. Redistributions in binary form must reproduce the above copyright
+       notice, this list of conditions and the following disclaimer in
+       the documentation and/or other materials provided with the
+       distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+    FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+    COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+    INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+    BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+    LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+    ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#ifndef FUZZYMATCH_H
+#define FUZZYMATCH_H
+
+#include "pqConsole_global.h"
+
+#include <QString>
+#include <QStringView>
+
+/** fuzzy match of a pattern as a subsequence of candidates
+ *
+ *  Case insensitive. Matches at start of name, after an underscore or
+ *  on a camel case hump score a bonus, as do runs of consecutive chars;
+ *  gaps and longer names are penalized.
+ *  mask() summarizes the characters of a name in a word, so that most
+ *  candidates can be discarded in a tight loop over an array of masks,
+ *  before scoring.
+ */
+class PQCONSOLESHARED_EXPORT FuzzyMatch {
+public:
+
+    explicit FuzzyMatch(QStringView pattern);
+
+    /** characters present in s, folded to lower case */
+    static quint64 mask(QStringView s);
+
+    /** mask bits every candidate must have */
+    quint64 need() const { return bits; }
+
+    /** pattern length */
+    int length() const { return pat.size(); }
+
+    /** score of candidate, < 0 if the pattern isn't a subsequence */
+    int score(QStringView s) const;
+
+    enum { no_match = -1 };
+
+private:
+    QString pat;
+    quint64 bits;
+};
+
+#endif // FUZZYMATCH_H
@@ -0,0 +1,83 @@
+/*  Part of SWI-Prolog interface to Qt
+
+    Author:        SWI-Prolog contributors
+    WWW:           https://www.swi-prolog.org
+    Copyright (c)  2026, SWI-Prolog contributors
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions
+    are met:
+
+    1. Redistributions of source code must retain the above copyright
+       notice, this list of conditions and the following disclaimer.
+
+    2. Redistributions in binary form must reproduce the above copyright
+       notice, this list of conditions and the following disclaimer in
+       the documentation and/or other materials provided with the
+       distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+    FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+    COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+    INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+    BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+    LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+    ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#include "GuiCommands.h"
+#include <QApplication>
+
+/** could be first accessed from a Prolog thread
+ */
+GuiCommands *GuiCommands::instance() {
+    static GuiCommands *s = [] {
+        auto g = new GuiCommands;
+        g->moveToThread(qApp->thread());
+        return g;
+    }();
+    return s;
+}
+
+/** only the post finding the queue empty needs to wake up the GUI:
+ *  later ones will be served by the same drain()
+ */
+void GuiCommands::post(QPointer<QObject> target, pfunc f, pfunc dropped) {
+    bool wake;
+    {   QMutexLocker lk(&sync);
+        wake = queue.isEmpty();
+        queue.append(command{target, std::move(f), std::move(dropped)});
+    }
+    if (wake)
+        QMetaObject::invokeMethod(this, "drain", Qt::QueuedConnection);
+}
+
+/** a command can run a modal loop (dialogs), re-entering here:
+ *  new commands are appended to the running batch, to keep order
+ */
+void GuiCommands::drain() {
+    {   QMutexLocker lk(&sync);
+        if (running.isEmpty())
+            running.swap(queue);
+        else {
+            running += queue;
+            queue.clear();
+        }
+    }
+    while (next < running.size()) {
+        command c = std::move(running[next++]);
+        if (c.target)
+            c.f();
+        else if (c.dropped)
+            c.dropped();
+    }
+    running.clear();
+    next = 0;
+}
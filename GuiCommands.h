@@ -0,0 +1,89 @@
+/*  Part of SWI-Prolog interface to Qt
+
+    Author:        SWI-Prolog contributors
+    WWW:           https://www.swi-prolog.org
+    Copyright (c)  2026, SWI-Prolog contributors
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions
+    are met:
+
+    1. Redistributions of source code must retain the above copyright
+       notice, this list of conditions and the following disclaimer.
+
+    2. Redistributions in binary form must reproduce the above copyright
+       notice, this list of conditions and the following disclaimer in
+       the documentation and/or other materials provided with the
+       distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+    FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+    COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+    INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+    BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+    LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+    ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#ifndef GUICOMMANDS_H
+#define GUICOMMANDS_H
+
+#include "pqConsole_global.h"
+#include "SwiPrologEngine.h"
+
+#include <QObject>
+#include <QPointer>
+#include <QVector>
+#include <QMutex>
+
+/** multi producer, single consumer queue of functions to run in GUI thread
+ *
+ *  Any thread can post; the first post on an empty queue wakes up the
+ *  GUI with one queued call, and the GUI runs everything posted up to
+ *  then in a single pass. Commands run in posting order, also when one
+ *  of them enters a modal loop that drains the queue meanwhile.
+ *  Commands whose target has been destroyed are dropped.
+ */
+class PQCONSOLESHARED_EXPORT GuiCommands : public QObject {
+    Q_OBJECT
+public:
+
+    static GuiCommands *instance();
+
+    /** queue f to run in GUI thread, while target lives
+     *  a guard taken by the caller is safe to pass from any thread
+     *  if target is gone, <dropped> runs instead: a waiting caller can resume
+     */
+    void post(QPointer<QObject> target, pfunc f, pfunc dropped = pfunc());
+
+private slots:
+
+    /** run all commands posted so far */
+    void drain();
+
+private:
+
+    GuiCommands() : next(0) {}
+
+    struct command {
+        QPointer<QObject> target;
+        pfunc f, dropped;
+    };
+
+    /** shared with producers */
+    QMutex sync;
+    QVector<command> queue;
+
+    /** GUI thread only: batch being run, and position in it */
+    QVector<command> running;
+    int next;
+};
+
+#endif // GUICOMMANDS_H
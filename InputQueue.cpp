@@ -0,0 +1,82 @@
+/*  Part of SWI-Prolog interface to Qt
+
+    Author:        SWI-Prolog contributors
+    WWW:           https://www.swi-prolog.org
+    Copyright (c)  2026, SWI-Prolog contributors
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions
+    are met:
+
+    1. Redistributions of source code must retain the above copyright
+       notice, this list of conditions and the following disclaimer.
+
+    2. Redistributions in binary form must reproduce the above copyright
+       notice, this list of conditions and the following disclaimer in
+       the documentation and/or other materials provided with the
+       distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+    FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+    COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+    INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+    BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+    LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+    ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "InputQueue.h"
+#include <string.h>
+
+InputQueue::InputQueue(int capacity)
+    : feeding(false),
+      head_off(0),
+      bytes(0),
+      cap(capacity)
+{
+}
+
+void InputQueue::push(const QByteArray &chunk) {
+    if (!chunk.isEmpty()) {
+        chunks.enqueue(chunk);
+        bytes += chunk.size();
+    }
+}
+
+bool InputQueue::offer(const QByteArray &chunk) {
+    if (bytes > 0 && bytes + chunk.size() > cap)
+        return false;
+    push(chunk);
+    return true;
+}
+
+/** chunks are shared, not copied: only the read position moves
+ */
+size_t InputQueue::read(char *buf, size_t len) {
+    size_t n = 0;
+    while (n < len && !chunks.isEmpty()) {
+        const QByteArray &h = chunks.head();
+        int l = int(qMin(len - n, size_t(h.size() - head_off)));
+        memcpy(buf + n, h.constData() + head_off, size_t(l));
+        n += l;
+        head_off += l;
+        if (head_off == h.size()) {
+            chunks.dequeue();
+            head_off = 0;
+        }
+    }
+    bytes -= int(n);
+    return n;
+}
+
+void InputQueue::clear() {
+    chunks.clear();
+    head_off = 0;
+    bytes = 0;
+}
@@ -0,0 +1,81 @@
+/*  Part of SWI-Prolog interface to Qt
+
+    Author:        SWI-Prolog contributors
+    WWW:           https://www.swi-prolog.org
+    Copyright (c)  2026, SWI-Prolog contributors
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions
+    are met:
+
+    1. Redistributions of source code must retain the above copyright
+       notice, this list of conditions and the following disclaimer.
+
+    2. Redistributions in binary form must reproduce the above copyright
+       notice, this list of conditions and the following disclaimer in
+       the documentation and/or other materials provided with the
+       distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+    FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+    COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+    INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+    BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+    LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+    ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef INPUTQUEUE_H
+#define INPUTQUEUE_H
+
+#include "pqConsole_global.h"
+
+#include <QQueue>
+#include <QByteArray>
+
+/** FIFO of UTF-8 input chunks, from console to a Prolog reader
+ *
+ *  Lines entered are appended, so typeahead while a goal runs
+ *  is kept in order. Streamed paste feeds it only while there is room.
+ *  Not syncronized: owners guard it with their own mutex.
+ */
+class PQCONSOLESHARED_EXPORT InputQueue {
+public:
+
+    explicit InputQueue(int capacity = 1 << 20);
+
+    /** append unconditionally: what the user typed is never refused */
+    void push(const QByteArray &chunk);
+
+    /** append if it fits, or if the queue is empty */
+    bool offer(const QByteArray &chunk);
+
+    /** move up to len bytes to buf, return how many */
+    size_t read(char *buf, size_t len);
+
+    bool empty() const { return bytes == 0; }
+    int size() const { return bytes; }
+    int capacity() const { return cap; }
+
+    void clear();
+
+    /** a paste is being streamed: more input will come, don't prompt */
+    bool feeding;
+
+private:
+
+    QQueue<QByteArray> chunks;
+
+    /** consumed part of chunks.head() */
+    int head_off;
+
+    int bytes, cap;
+};
+
+#endif // INPUTQUEUE_H
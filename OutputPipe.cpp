@@ -0,0 +1,149 @@
+/*  Part of SWI-Prolog interface to Qt
+
+    Author:        SWI-Prolog contributors
+    WWW:           https://www.swi-prolog.org
+    Copyright (c)  2026, SWI-Prolog contributors
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions
+    are met:
+
+    1. Redistributions of source code must retain the above copyright
+       notice, this list of conditions and the following disclaimer.
+
+    2. Redistributions in binary form must reproduce the above copyright
+       notice, this list of conditions and the following disclaimer in
+       the documentation and/or other materials provided with the
+       distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+    FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+    COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+    INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+    BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+    LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+    ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "OutputPipe.h"
+#include <QCoreApplication>
+
+OutputPipe::OutputPipe(OutputRing &ring, QObject *target)
+    : ring(ring),
+      target(target),
+      notified(false),
+      held_bytes(0),
+      hold_limit(ring.capacity()),
+      starved(false)
+{
+}
+
+/** a single thread is enough: decoding is much cheaper than display
+ */
+QThread *OutputPipe::worker() {
+    static QThread *t;
+    if (!t) {
+        t = new QThread;
+        t->setObjectName("console output");
+        QObject::connect(qApp, &QCoreApplication::aboutToQuit, [=]() {
+            t->quit();
+            t->wait();
+        });
+        t->start();
+    }
+    return t;
+}
+
+void OutputPipe::detach() {
+    QMutexLocker l1(&ingesting);
+    QMutexLocker l2(&ready_lock);
+    target = 0;
+}
+
+/** read in chunks small enough to be appended within a frame
+ */
+void OutputPipe::ingest() {
+    QMutexLocker lk(&ingesting);
+    if (!target)
+        return;
+
+    const size_t chunk = 16 * 1024;
+    for ( ; ; ) {
+        if (held_bytes >= hold_limit) {
+            // recheck after raising the flag: take() could have run in between
+            starved = true;
+            if (held_bytes >= hold_limit) {
+                // a parked console must be served anyway
+                QMetaObject::invokeMethod(target, "output_ready", Qt::QueuedConnection);
+                return;
+            }
+            if (!starved.exchange(false))
+                return;
+        }
+
+        ring.disarm();
+
+        int c = carry.size();
+        carry.resize(c + int(chunk));
+        size_t n = ring.read(carry.data() + c, chunk);
+        carry.resize(c + int(n));
+        // a write after disarm() has queued another ingest()
+        if (!n)
+            return;
+        ring.notify();
+
+        int l = int(OutputRing::utf8_complete(carry.constData(), size_t(carry.size())));
+        batch b;
+        b.text = QString::fromUtf8(carry.constData(), l);
+        b.bytes = n;
+        carry.remove(0, l);
+
+#if defined(Q_OS_WIN)
+        b.text.replace("\r\n", "\n");
+#endif
+
+        // the parser keeps the style across calls: restart numbering only when it grows
+        if (ansi.styles().size() > 256)
+            ansi.clear_styles();
+        ansi.parse(b.text.constData(), b.text.length(), b.runs);
+        b.styles = ansi.styles();
+
+        publish(b);
+    }
+}
+
+/** notify the GUI only for the first batch it hasn't seen yet
+ */
+void OutputPipe::publish(batch &b) {
+    held_bytes += b.bytes;
+
+    QMutexLocker lk(&ready_lock);
+    ready.append(b);
+    if (!notified) {
+        notified = true;
+        QMetaObject::invokeMethod(target, "output_ready", Qt::QueuedConnection);
+    }
+}
+
+bool OutputPipe::take(batch &b) {
+    {   QMutexLocker lk(&ready_lock);
+        if (ready.isEmpty()) {
+            notified = false;
+            return false;
+        }
+        b = ready.takeFirst();
+    }
+
+    held_bytes -= b.bytes;
+    // writers throttled on backlog count held bytes too
+    ring.notify();
+    if (held_bytes < hold_limit && starved.exchange(false))
+        QMetaObject::invokeMethod(this, "ingest", Qt::QueuedConnection);
+    return true;
+}
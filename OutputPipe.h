@@ -0,0 +1,115 @@
+/*  Part of SWI-Prolog interface to Qt
+
+    Author:        SWI-Prolog contributors
+    WWW:           https://www.swi-prolog.org
+    Copyright (c)  2026, SWI-Prolog contributors
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions
+    are met:
+
+    1. Redistributions of source code must retain the above copyright
+       notice, this list of conditions and the following disclaimer.
+
+    2. Redistributions in binary form must reproduce the above copyright
+       notice, this list of conditions and the following disclaimer in
+       the documentation and/or other materials provided with the
+       distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+    FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+    COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+    INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+    BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+    LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+    ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef OUTPUTPIPE_H
+#define OUTPUTPIPE_H
+
+#include "pqConsole_global.h"
+#include "OutputRing.h"
+#include "ansi_esc_seq.h"
+
+#include <QObject>
+#include <QThread>
+#include <QList>
+
+/** ingestion stage between an OutputRing and its console
+ *
+ *  Runs on a thread shared by all consoles: drains the ring, decodes
+ *  UTF-8 and parses escape sequences, and hands the GUI immutable
+ *  batches of text and style runs, that it only has to append.
+ *  Bytes held in batches count as backlog: when the GUI falls behind,
+ *  ingestion stops, the ring fills and writers wait.
+ */
+class PQCONSOLESHARED_EXPORT OutputPipe : public QObject {
+    Q_OBJECT
+public:
+
+    /** decoded output, runs refer to text and to the batch own styles */
+    struct batch {
+        QString text;
+        QVector<ANSI_ESC_SEQ::run> runs;
+        QVector<ANSI_ESC_SEQ::SGR> styles;
+        size_t bytes;
+    };
+
+    /** <target> gets output_ready() invoked when batches are ready */
+    OutputPipe(OutputRing &ring, QObject *target);
+
+    /** the thread ingesting for all consoles, started on first use */
+    static QThread *worker();
+
+    /** GUI side: pop the oldest ready batch, false when none */
+    bool take(batch &b);
+
+    /** bytes held in batches, not yet taken */
+    size_t held() const { return held_bytes; }
+
+    /** holding up to limit: writers will wait for the GUI */
+    bool full() const { return held_bytes >= hold_limit; }
+
+    /** stop reading the ring while holding this much */
+    void set_limit(size_t limit) { hold_limit = limit; }
+
+    /** target is going away: no more ring access nor notifications */
+    void detach();
+
+public slots:
+
+    /** move what's in the ring to ready batches */
+    void ingest();
+
+private:
+
+    OutputRing &ring;
+    QObject *target;
+
+    /** ingest() can run on worker, or on a GUI writer finding the ring full */
+    QMutex ingesting;
+    QByteArray carry;
+    ANSI_ESC_SEQ ansi;
+
+    /** batches handed over, and if the GUI has been notified about them */
+    QMutex ready_lock;
+    QList<batch> ready;
+    bool notified;
+
+    std::atomic<size_t> held_bytes;
+    std::atomic<size_t> hold_limit;
+
+    /** ingest() stopped on hold limit: take() must restart it */
+    std::atomic<bool> starved;
+
+    void publish(batch &b);
+};
+
+#endif // OUTPUTPIPE_H
@@ -0,0 +1,121 @@
+/*  Part of SWI-Prolog interface to Qt
+
+    Author:        SWI-Prolog contributors
+    WWW:           https://www.swi-prolog.org
+    Copyright (c)  2026, SWI-Prolog contributors
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions
+    are met:
+
+    1. Redistributions of source code must retain the above copyright
+       notice, this list of conditions and the following disclaimer.
+
+    2. Redistributions in binary form must reproduce the above copyright
+       notice, this list of conditions and the following disclaimer in
+       the documentation and/or other materials provided with the
+       distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+    FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+    COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+    INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+    BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+    LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+    ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "OutputRing.h"
+#include <string.h>
+
+OutputRing::OutputRing(size_t capacity)
+    : head(0), tail(0), armed(false), waiters(0)
+{
+    size_t c = 1024;
+    while (c < capacity)
+        c <<= 1;
+    data = new char[c];
+    mask = c - 1;
+}
+
+OutputRing::~OutputRing() {
+    delete [] data;
+}
+
+/** copy in at most the free space, wrapping around the end
+ */
+size_t OutputRing::write(const char *buf, size_t len) {
+    size_t h = head, t = tail;
+    size_t n = capacity() - (h - t);
+    if (n > len)
+        n = len;
+    if (n) {
+        size_t p = h & mask, l = capacity() - p;
+        if (l > n)
+            l = n;
+        memcpy(data + p, buf, l);
+        memcpy(data, buf + l, n - l);
+        head = h + n;
+    }
+    return n;
+}
+
+/** copy out at most what's available, wrapping around the end
+ */
+size_t OutputRing::read(char *buf, size_t len) {
+    size_t t = tail, h = head;
+    size_t n = h - t;
+    if (n > len)
+        n = len;
+    if (n) {
+        size_t p = t & mask, l = capacity() - p;
+        if (l > n)
+            l = n;
+        memcpy(buf, data + p, l);
+        memcpy(buf + l, data, n - l);
+        tail = t + n;
+    }
+    return n;
+}
+
+/** the consumer could be late (modal loop, busy GUI):
+ *  wake up periodically just to recheck
+ */
+void OutputRing::wait_below(size_t limit) {
+    QMutexLocker lk(&wait_lock);
+    ++waiters;
+    while (size() > limit)
+        drained.wait(&wait_lock, 100);
+    --waiters;
+}
+
+void OutputRing::notify() {
+    if (waiters) {
+        QMutexLocker lk(&wait_lock);
+        drained.wakeAll();
+    }
+}
+
+/** a batch boundary can fall inside a multibyte character:
+ *  leave the incomplete tail to be decoded with the next batch
+ */
+size_t OutputRing::utf8_complete(const char *s, size_t n) {
+    for (size_t i = n, k = 0; i > 0 && k < 4; --i, ++k) {
+        unsigned char c = s[i - 1];
+        if ((c & 0xC0) != 0x80) {
+            size_t need =
+                c < 0x80 ? 1 :
+                (c & 0xE0) == 0xC0 ? 2 :
+                (c & 0xF0) == 0xE0 ? 3 :
+                (c & 0xF8) == 0xF0 ? 4 : 1;
+            return n - (i - 1) >= need ? n : i - 1;
+        }
+    }
+    return n;
+}
@@ -0,0 +1,102 @@
+/*  Part of SWI-Prolog interface to Qt
+
+    Author:        SWI-Prolog contributors
+    WWW:           https://www.swi-prolog.org
+    Copyright (c)  2026, SWI-Prolog contributors
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions
+    are met:
+
+    1. Redistributions of source code must retain the above copyright
+       notice, this list of conditions and the following disclaimer.
+
+    2. Redistributions in binary form must reproduce the above copyright
+       notice, this list of conditions and the following disclaimer in
+       the documentation and/or other materials provided with the
+       distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+    FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+    COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+    INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+    BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+    LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+    ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef OUTPUTRING_H
+#define OUTPUTRING_H
+
+#include "pqConsole_global.h"
+
+#include <QMutex>
+#include <QWaitCondition>
+#include <atomic>
+
+/** fixed size byte ring between Prolog writer threads and the GUI
+ *  writers append raw UTF-8, the console drains it in large batches
+ *
+ *  data transfer is single producer / single consumer and lock free:
+ *  concurrent writers (user_output and user_error share a console)
+ *  are serialized on <producer>, the consumer never locks
+ */
+class PQCONSOLESHARED_EXPORT OutputRing {
+public:
+
+    /** capacity is rounded up to a power of 2 */
+    explicit OutputRing(size_t capacity = 1 << 20);
+    ~OutputRing();
+
+    /** producer side: store up to len bytes, return how many fit */
+    size_t write(const char *buf, size_t len);
+
+    /** consumer side: fetch up to len bytes, return how many were available */
+    size_t read(char *buf, size_t len);
+
+    /** bytes waiting to be consumed */
+    size_t size() const { return head - tail; }
+    size_t capacity() const { return mask + 1; }
+
+    /** coalesce wakeups: true if the caller must notify the consumer */
+    bool arm() { return !armed.exchange(true); }
+
+    /** consumer is about to drain: next write will notify again */
+    void disarm() { armed = false; }
+
+    /** serialize writers sharing the ring */
+    QMutex producer;
+
+    /** producer side: sleep until the consumer brings size() down to limit */
+    void wait_below(size_t limit);
+
+    /** consumer side: after read(), wake producers waiting for room */
+    void notify();
+
+    /** length of the longest prefix of s not ending in a truncated UTF-8 sequence */
+    static size_t utf8_complete(const char *s, size_t n);
+
+private:
+
+    char *data;
+    size_t mask;
+
+    /** free running counters, masked on access */
+    std::atomic<size_t> head, tail;
+    std::atomic<bool> armed;
+
+    /** blocking is the exception: consumer locks only when someone waits */
+    QMutex wait_lock;
+    QWaitCondition drained;
+    std::atomic<int> waiters;
+
+    Q_DISABLE_COPY(OutputRing)
+};
+
+#endif // OUTPUTRING_H
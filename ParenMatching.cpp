@@ -35,44 +35,156 @@
 #include <QTextStream>
 #include <QTextBlock>
 #include <QtGlobal>
+#include <climits>
 
-ParenMatching::ParenMatching(QTextCursor c)
+/** Prolog lexical rules relevant to brackets:
+ *  %... and / * ... * / comments, 'quoted', "string", `backquoted` with
+ *  \ escapes and doubled quotes, 0'c character codes
+ */
+int ParenMatching::scan(const QString &text, int from, int in, QVector<BlockData::bracket> &brackets) {
+    int state = in, n = text.length();
+    for (int i = from; i < n; ) {
+        QChar c = text[i];
+        switch (state) {
+        case comment:
+            if (c == '*' && i + 1 < n && text[i + 1] == '/')
+                state = code, i += 2;
+            else
+                ++i;
+            break;
+        case quoted:
+        case string:
+        case backquoted: {
+            QChar q = state == quoted ? '\'' : state == string ? '"' : '`';
+            if (c == '\\')
+                i += 2;
+            else if (c == q) {
+                if (i + 1 < n && text[i + 1] == q)
+                    i += 2;
+                else
+                    state = code, ++i;
+            }
+            else
+                ++i;
+        }   break;
+        default:
+            if (c == '%')
+                return code;
+            if (c == '/' && i + 1 < n && text[i + 1] == '*')
+                state = comment, i += 2;
+            else if (c == '\'') {
+                if (i > 0 && text[i - 1] == '0' && (i < 2 || !(text[i - 2].isLetterOrNumber() || text[i - 2] == '_')))
+                    i += i + 1 < n && text[i + 1] == '\\' ? 3 : 2;  // 0'c
+                else
+                    state = quoted, ++i;
+            }
+            else if (c == '"')
+                state = string, ++i;
+            else if (c == '`')
+                state = backquoted, ++i;
+            else {
+                if (c == '(' || c == ')' || c == '[' || c == ']' || c == '{' || c == '}')
+                    brackets.append(BlockData::bracket {i, c});
+                ++i;
+            }
+        }
+    }
+    return state;
+}
+
+BlockData *ParenMatching::index(QTextBlock b, int in, int from) {
+    BlockData *d = BlockData::of(b);
+    if (b.userState() < 0 || d->in != in || d->from != from) {
+        d->in = in;
+        d->from = from;
+        d->brackets.clear();
+        b.setUserState(scan(b.text(), from, in, d->brackets));
+    }
+    return d;
+}
+
+void ParenMatching::invalidate(QTextDocument *doc, int position, int removed, int added) {
+    Q_UNUSED(removed)
+    QTextBlock b = doc->findBlock(position), e = doc->findBlock(position + added);
+    for ( ; b.isValid(); b = b.next()) {
+        b.setUserState(-1);
+        if (b == e)
+            break;
+    }
+}
+
+/** matching is a walk on the bracket index of blocks, counting nesting
+ *  lines from start are chained: a quote or comment can span them
+ */
+ParenMatching::ParenMatching(QTextCursor c, int start)
     : onOpen(false)
 {
-    int save_p = c.position();
-    QChar p = cc(c), q;
-    QTextCursor::MoveOperation d = c.NoMove;
-
-    if (p == '(') q = ')', d = c.Right, onOpen = true;
-    if (p == '[') q = ']', d = c.Right, onOpen = true;
-    if (p == '{') q = '}', d = c.Right, onOpen = true;
-
-    if (d == c.NoMove && c.movePosition(c.Left)) {
-        p = cc(c);
-        if (p == ')') q = '(', d = c.Left;
-        if (p == ']') q = '[', d = c.Left;
-        if (p == '}') q = '{', d = c.Left;
-    }
+    QTextDocument *doc = c.document();
+    int pos = c.position();
+    QTextBlock b = c.block(), s = doc->findBlock(start);
+    int sn = s.isValid() ? s.blockNumber() : INT_MAX;
+
+    // index of block k, given the one before is current
+    auto at = [&](QTextBlock k) {
+        if (k.blockNumber() < sn)
+            return index(k, code, 0);
+        if (k == s)
+            return index(k, code, start - k.position());
+        return index(k, k.previous().userState(), 0);
+    };
+
+    if (b.blockNumber() > sn)
+        for (QTextBlock k = s; k != b; k = k.next())
+            at(k);
+    BlockData *d = at(b);
+
+    // bracket at cursor, or before it
+    int o = pos - b.position(), i = -1;
+    for (int x = 0; x < d->brackets.size(); ++x)
+        if (d->brackets[x].pos == o && QString("([{").contains(d->brackets[x].c))
+            i = x, onOpen = true;
+        else if (i < 0 && d->brackets[x].pos == o - 1 && QString(")]}").contains(d->brackets[x].c))
+            i = x;
+    if (i < 0)
+        return;
+
+    QChar p = d->brackets[i].c, q = p == '(' ? ')' : p == '[' ? ']' : p == '{' ? '}' :
+                                    p == ')' ? '(' : p == ']' ? '[' : '{';
+    int n = 0, here = b.position() + d->brackets[i].pos;
+    QTextBlock k = b;
 
-    if (d != c.NoMove) {
-        int n = 0;
-        while (c.movePosition(d)) {
-            QChar z = cc(c);
-            if (z == q) {
-                if (n-- == 0) {
-                    if (onOpen)
-                        positions = range(save_p, c.position());
-                    else
-                        positions = range(c.position(), save_p - 1);
-                    break;
+    if (onOpen)
+        for (int j = i + 1; ; j = 0) {
+            for ( ; j < d->brackets.size(); ++j) {
+                QChar z = d->brackets[j].c;
+                if (z == q && n-- == 0) {
+                    positions = range(here, k.position() + d->brackets[j].pos);
+                    return;
                 }
+                if (z == p)
+                    ++n;
             }
-            else if (z == p)
-                ++n;
+            if (!(k = k.next()).isValid())
+                return;
+            d = at(k);
+        }
+    else
+        for (int j = i - 1; ; ) {
+            for ( ; j >= 0; --j) {
+                QChar z = d->brackets[j].c;
+                if (z == q && n-- == 0) {
+                    positions = range(k.position() + d->brackets[j].pos, here);
+                    return;
+                }
+                if (z == p)
+                    ++n;
+            }
+            if (!(k = k.previous()).isValid())
+                return;
+            // lines from start were indexed on the way to b
+            d = at(k);
+            j = d->brackets.size() - 1;
         }
-    }
-
-    c.setPosition(save_p);
 }
 
 #if QT_VERSION >= QT_VERSION_CHECK(5,14,0)
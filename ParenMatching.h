@@ -40,6 +40,7 @@
 #include <QTextCursor>
 #include <QTextDocument>
 #include <QTextCharFormat>
+#include "BlockData.h"
 
 /** get open/close parenthesis matching from QTextCursor current position
  */
@@ -73,27 +74,7 @@ public:
             return C;
         }
 
-        /** apply range formatting to cursor */
-        static QTextCursor format(QTextCursor c, int p, int n = 1, QTextCharFormat f = QTextCharFormat()) {
-            c.setPosition(p);
-            c.movePosition(c.Right, c.KeepAnchor, n);
-            c.setCharFormat(f);
-            return c;
-        }
-
-        /** apply range formatting to cursor */
-        QTextCursor format(QTextCursor c, QTextCharFormat f = QTextCharFormat()) const {
-             select(c).setCharFormat(f);
-             return c;
-        }
-
-        /** apply formatting to cursor */
-        QTextCursor format_both(QTextCursor c, QTextCharFormat f = QTextCharFormat()) const {
-            return format(format(c, beg, 1, f), end, 1, f);
-        }
-
         /** some common usage */
-        static QTextCharFormat bold() { QTextCharFormat f; f.setFontWeight(QFont::Bold); return f; }
         static QTextCharFormat underline_wave(bool y = true) {
             QTextCharFormat f;
             f.setUnderlineStyle(y ? f.WaveUnderline : f.NoUnderline);
@@ -114,8 +95,22 @@ public:
         return QChar();
     }
 
-    /** apply matching to current cursor position */
-    explicit ParenMatching(QTextCursor c);
+    /** lexical state at end of a line: brackets in quotes and comments don't count */
+    enum lex { code, comment, quoted, string, backquoted };
+
+    /** apply matching to current cursor position
+     *  text from <start> (the input) is scanned as a whole, lines before one by one
+     */
+    explicit ParenMatching(QTextCursor c, int start = 0);
+
+    /** mark blocks changed by an edit, to be scanned again when needed */
+    static void invalidate(QTextDocument *doc, int position, int removed, int added);
+
+    /** bracket index of block, scanned from offset <from> in state <in> unless current */
+    static BlockData *index(QTextBlock b, int in, int from);
+
+    /** collect brackets of text from offset <from> in state <in>, return state at end */
+    static int scan(const QString &text, int from, int in, QVector<BlockData::bracket> &brackets);
 
     /** true if match found */
     operator bool() const { return positions.size() > 0; }
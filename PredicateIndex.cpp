@@ -0,0 +1,308 @@
+/*  Part of SWI-Prolog interface to Qt
+
+    Author:        SWI-Prolog contributors
+    WWW:           https://www.swi-prolog.org
+    Copyright (c)  2026, SWI-Prolog contributors
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions
+    are met:
+
+    1. Redistributions of source code must retain the above copyright
+       notice, this list of conditions and the following disclaimer.
+
+    2. Redistributions in binary form must reproduce the above copyright
+       notice, this list of conditions and the following disclaimer in
+       the documentation and/or other materials provided with the
+       distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+    FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+    COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+    INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+    BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+    LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+    ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#include "PredicateIndex.h"
+#include "QueryExecutor.h"
+#include "PREDICATE.h"
+#include "FuzzyMatch.h"
+#include "GuiCommands.h"
+#include <QCoreApplication>
+#include <QTimer>
+#include <QSet>
+#include <QHash>
+#include <QDebug>
+#include <algorithm>
+#include <vector>
+
+namespace {
+
+/** an entry while building, before packing names */
+struct item {
+    QString name;
+    int module, arity;
+    bool operator<(const item &o) const {
+        int c = name.compare(o.name);
+        return c < 0 || (c == 0 && (arity < o.arity || (arity == o.arity && module < o.module)));
+    }
+};
+
+/** enumerate current_predicate(M:N/A), M unbound for all modules
+ *  names starting with $ are system internals, skip them
+ */
+void enumerate(QString m, QStringList &modules, QHash<QString, int> &module_ids, QVector<item> &items) {
+    PlTerm_var M, N, Ar;
+    if (!m.isEmpty())
+        PlCheckFail(M.unify_atom(W(m)));
+    PlQuery q("current_predicate", PlTermv(PlCompound(":", PlTermv(M, PlCompound("/", PlTermv(N, Ar))))));
+    while (q.next_solution()) {
+        QString n = t2w(N);
+        if (n.startsWith('$'))
+            continue;
+        QString mod = t2w(M);
+        auto i = module_ids.constFind(mod);
+        if (i == module_ids.constEnd()) {
+            i = module_ids.insert(mod, modules.size());
+            modules.append(mod);
+        }
+        items.append(item {n, i.value(), Ar.as_int()});
+    }
+}
+
+/** pack sorted items in a snapshot */
+PredicateIndex::snapshot *pack(const QVector<item> &items, const QStringList &modules) {
+    auto s = new PredicateIndex::snapshot;
+    s->modules = modules;
+    s->entries.reserve(items.size());
+    s->masks.reserve(items.size());
+    int chars = 0;
+    for (const item &i : items)
+        chars += i.name.size();
+    s->names.reserve(chars);
+    for (const item &i : items) {
+        // consecutive duplicates share storage
+        if (!s->entries.isEmpty() && s->name(s->entries.last()) == i.name) {
+            s->entries.append({s->entries.last().off, int(i.name.size()), i.module, i.arity});
+            s->masks.append(s->masks.last() | PredicateIndex::snapshot::repeated);
+        }
+        else {
+            s->entries.append({int(s->names.size()), int(i.name.size()), i.module, i.arity});
+            s->masks.append(FuzzyMatch::mask(i.name));
+            s->names += i.name;
+        }
+    }
+    return s;
+}
+
+}
+
+PredicateIndex *PredicateIndex::instance() {
+    static PredicateIndex *x = new PredicateIndex;
+    return x;
+}
+
+QPair<int, int> PredicateIndex::snapshot::prefixed(QStringView prefix) const {
+    auto lt = [this](const entry &e, QStringView p) { return name(e).compare(p) < 0; };
+    auto b = std::lower_bound(entries.begin(), entries.end(), prefix, lt), e = b;
+    while (e != entries.end() && name(*e).startsWith(prefix))
+        ++e;
+    return qMakePair(int(b - entries.begin()), int(e - entries.begin()));
+}
+
+/** the mask test runs branch free over a batch, to let the compiler
+ *  vectorize it: only survivors are scored, keeping the best <k> in a heap
+ */
+QVector<int> PredicateIndex::snapshot::fuzzy(QStringView pattern, int k) const {
+    QVector<int> r;
+    if (k <= 0)
+        return r;
+
+    FuzzyMatch fm(pattern);
+    const quint64 need = fm.need(), test = need | repeated;
+    const quint64 *m = masks.constData();
+    const int n = masks.size();
+
+    // (score, -index): ties go to the first in name order
+    typedef QPair<int, int> scored;
+    std::vector<scored> best;
+    best.reserve(k + 1);
+    auto better = [](const scored &a, const scored &b) { return a > b; };
+
+    enum { batch = 256 };
+    unsigned char hit[batch];
+    for (int b = 0; b < n; b += batch) {
+        const int e = qMin(n, b + batch);
+        for (int i = b; i < e; ++i)
+            hit[i - b] = (m[i] & test) == need;
+        for (int i = b; i < e; ++i) {
+            if (!hit[i - b] || entries[i].len < fm.length())
+                continue;
+            int v = fm.score(name(entries[i]));
+            if (v < 0)
+                continue;
+            scored x(v, -i);
+            if (int(best.size()) < k) {
+                best.push_back(x);
+                std::push_heap(best.begin(), best.end(), better);
+            }
+            else if (better(x, best.front())) {
+                std::pop_heap(best.begin(), best.end(), better);
+                best.back() = x;
+                std::push_heap(best.begin(), best.end(), better);
+            }
+        }
+    }
+
+    std::sort(best.begin(), best.end(), better);
+    r.reserve(int(best.size()));
+    for (const scored &x : best)
+        r.append(-x.second);
+    return r;
+}
+
+PredicateIndex::snap PredicateIndex::current() const {
+    QMutexLocker lk(&lock);
+    return snp;
+}
+
+/** the hook must fail, to let messages through
+ *  it goes first: a user hook succeeding on load messages would hide them
+ */
+void PredicateIndex::start() {
+    if (started.exchange(true))
+        return;
+    QueryExecutor::instance()->submit([this]() {
+        bool hooked = false;
+        try {
+            hooked = PlCall("asserta((user:message_hook(load_file(done(_,_,_,M,_,_)),_,_) :- "
+                            "pqConsole:pq_module_loaded(M), fail))");
+        }
+        catch(const PlException& e) {
+            qDebug() << CCP(e);
+        }
+        if (!hooked)
+            GuiCommands::instance()->post(qApp, [this]() {
+                auto t = new QTimer(qApp);
+                QObject::connect(t, &QTimer::timeout, [this]() { poll(); });
+                t->start(rebuild_period);
+            });
+        build();
+    }, QueryExecutor::Background);
+}
+
+/** a rebuild still running when the timer fires again is not repeated
+ */
+void PredicateIndex::poll() {
+    if (rebuilding.exchange(true))
+        return;
+    QueryExecutor::instance()->submit([this]() {
+        build();
+        rebuilding = false;
+    }, QueryExecutor::Background);
+}
+
+void PredicateIndex::module_loaded(QString module) {
+    QMutexLocker lk(&lock);
+    if (!pending.contains(module))
+        pending.append(module);
+    if (scheduled || !snp)
+        return;
+    scheduled = true;
+    QueryExecutor::instance()->submit([this]() { refresh(); }, QueryExecutor::Background);
+}
+
+void PredicateIndex::build() {
+    QStringList modules;
+    QHash<QString, int> module_ids;
+    QVector<item> items;
+    try {
+        enumerate(QString(), modules, module_ids, items);
+    }
+    catch(const PlException& e) {
+        qDebug() << CCP(e);
+        return;
+    }
+    std::sort(items.begin(), items.end());
+    snap s(pack(items, modules));
+
+    QMutexLocker lk(&lock);
+    snp = s;
+    // modules loaded meanwhile may be there already: refreshing is harmless
+    if (!pending.isEmpty() && !scheduled) {
+        scheduled = true;
+        QueryExecutor::instance()->submit([this]() { refresh(); }, QueryExecutor::Background);
+    }
+}
+
+/** replace entries of pending modules, merging with the rest
+ *  loops until no more pending: only one refresh runs at a time
+ */
+void PredicateIndex::refresh() {
+    for ( ; ; ) {
+        QStringList todo;
+        snap old;
+        {   QMutexLocker lk(&lock);
+            if (pending.isEmpty()) {
+                scheduled = false;
+                return;
+            }
+            todo.swap(pending);
+            old = snp;
+        }
+        snap s(merge(old, todo));
+        QMutexLocker lk(&lock);
+        snp = s;
+    }
+}
+
+/** with <todo> modules content refreshed
+ */
+PredicateIndex::snapshot *PredicateIndex::merge(snap old, QStringList todo) {
+
+    QStringList modules = old->modules;
+    QHash<QString, int> module_ids;
+    for (int i = 0; i < modules.size(); ++i)
+        module_ids.insert(modules[i], i);
+
+    QVector<item> fresh;
+    try {
+        foreach (QString m, todo)
+            enumerate(m, modules, module_ids, fresh);
+    }
+    catch(const PlException& e) {
+        qDebug() << CCP(e);
+        return new snapshot(*old);
+    }
+    std::sort(fresh.begin(), fresh.end());
+
+    QSet<int> replaced;
+    foreach (QString m, todo)
+        replaced.insert(module_ids.value(m, -1));
+
+    // both sides are sorted: merge
+    QVector<item> items;
+    items.reserve(old->entries.size() + fresh.size());
+    auto f = fresh.constBegin();
+    for (const auto &e : old->entries) {
+        if (replaced.contains(e.module))
+            continue;
+        item i {old->name(e).toString(), e.module, e.arity};
+        for ( ; f != fresh.constEnd() && *f < i; ++f)
+            items.append(*f);
+        items.append(i);
+    }
+    for ( ; f != fresh.constEnd(); ++f)
+        items.append(*f);
+
+    return pack(items, modules);
+}
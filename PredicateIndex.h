@@ -0,0 +1,118 @@
+/*  Part of SWI-Prolog interface to Qt
+
+    Author:        SWI-Prolog contributors
+    WWW:           https://www.swi-prolog.org
+    Copyright (c)  2026, SWI-Prolog contributors
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions
+    are met:
+
+    1. Redistributions of source code must retain the above copyright
+       notice, this list of conditions and the following disclaimer.
+
+    2. Redistributions in binary form must reproduce the above copyright
+       notice, this list of conditions and the following disclaimer in
+       the documentation and/or other materials provided with the
+       distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+    FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+    COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+    INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+    BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+    LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+    ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#ifndef PREDICATEINDEX_H
+#define PREDICATEINDEX_H
+
+#include "pqConsole_global.h"
+
+#include <QMutex>
+#include <QVector>
+#include <QStringList>
+#include <QStringView>
+#include <QSharedPointer>
+#include <atomic>
+
+/** sorted index of predicate indicators, for completion
+ *
+ *  Built once in background, then kept current a module at a time:
+ *  a message_hook on load_file done reports each loaded module.
+ *  Readers get an immutable snapshot, so lookups don't lock Prolog
+ *  nor the index, and take a binary search.
+ *  Names are packed in a single string, entries only hold offsets.
+ */
+class PQCONSOLESHARED_EXPORT PredicateIndex {
+public:
+
+    struct snapshot {
+        struct entry { int off, len, module, arity; };
+
+        QString names;
+        QStringList modules;
+        QVector<entry> entries;     // sorted by name, arity, module
+
+        /** FuzzyMatch::mask() of each entry name, parallel to entries
+         *  entries repeating the previous name are flagged, to score names once
+         */
+        QVector<quint64> masks;
+        static const quint64 repeated = quint64(1) << 63;
+
+        QStringView name(const entry &e) const { return QStringView(names).mid(e.off, e.len); }
+        QString module(const entry &e) const { return modules[e.module]; }
+
+        /** range of entries whose name starts with prefix */
+        QPair<int, int> prefixed(QStringView prefix) const;
+
+        /** first entries of the <k> names best matching pattern, best first */
+        QVector<int> fuzzy(QStringView pattern, int k) const;
+    };
+    typedef QSharedPointer<const snapshot> snap;
+
+    static PredicateIndex *instance();
+
+    /** build in background and install the load hook, once */
+    void start();
+
+    /** false until first build completed */
+    bool ready() const { return !current().isNull(); }
+
+    /** current content */
+    snap current() const;
+
+    /** refresh predicates of module, from any thread - coalesced in background */
+    void module_loaded(QString module);
+
+private:
+
+    PredicateIndex() : started(false), rebuilding(false), scheduled(false) {}
+
+    std::atomic<bool> started;
+
+    /** without the load hook, rebuild every rebuild_period msecs */
+    enum { rebuild_period = 30000 };
+    std::atomic<bool> rebuilding;
+    void poll();
+
+    mutable QMutex lock;
+    snap snp;
+    QStringList pending;
+    bool scheduled;
+
+    /** with an engine attached: full build, and refresh of <pending> modules */
+    void build();
+    void refresh();
+    snapshot *merge(snap old, QStringList todo);
+};
+
+#endif // PREDICATEINDEX_H
@@ -0,0 +1,412 @@
+/*  Part of SWI-Prolog interface to Qt
+
+    Author:        SWI-Prolog contributors
+    WWW:           https://www.swi-prolog.org
+    Copyright (c)  2026, SWI-Prolog contributors
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions
+    are met:
+
+    1. Redistributions of source code must retain the above copyright
+       notice, this list of conditions and the following disclaimer.
+
+    2. Redistributions in binary form must reproduce the above copyright
+       notice, this list of conditions and the following disclaimer in
+       the documentation and/or other materials provided with the
+       distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+    FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+    COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+    INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+    BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+    LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+    ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "QueryExecutor.h"
+#include "PREDICATE.h"
+
+#include <QDebug>
+#include <QCoreApplication>
+#include <signal.h>
+
+/** SIGUSR2 is SWI-Prolog alert signal, use the other one
+ *  on Windows, signals raised by PL_thread_raise are emulated by Prolog
+ */
+#ifdef SIGUSR1
+static const int cancel_signal = SIGUSR1;
+#else
+static const int cancel_signal = 10;
+#endif
+
+/** the query being served by a worker */
+static thread_local QueryHandle *current;
+
+QueryHandle::QueryHandle(QString module, QString text, pfunc job, int priority, Mode mode, int batch)
+    : module(module),
+      text(text),
+      job(job),
+      priority(priority),
+      mode(mode),
+      batch(qMax(1, batch)),
+      st(Queued),
+      requested(0),
+      suspended(false),
+      serving(false),
+      orphaned(false),
+      thread_id(0),
+      cancel_requested(false)
+{
+}
+
+QueryHandle::State QueryHandle::state() const {
+    QMutexLocker lk(&lock);
+    return st;
+}
+
+bool QueryHandle::wait(unsigned long msec) {
+    QMutexLocker lk(&lock);
+    while (st <= Running)
+        if (!done.wait(&lock, msec))
+            return false;
+    return true;
+}
+
+QList<QueryBindings> QueryHandle::solutions() const {
+    QMutexLocker lk(&lock);
+    return sols;
+}
+
+QString QueryHandle::error() const {
+    QMutexLocker lk(&lock);
+    return err;
+}
+
+void QueryHandle::fetch(int n) {
+    QMutexLocker lk(&lock);
+    requested += n;
+    more.wakeAll();
+}
+
+bool QueryHandle::wait_fetch() {
+    QMutexLocker lk(&lock);
+    suspended = true;
+    while (requested == 0 && !cancel_requested)
+        more.wait(&lock);
+    suspended = false;
+    if (cancel_requested)
+        return false;
+    --requested;
+    return true;
+}
+
+/** a running query gets an exception at the next safe point
+ *  a suspended one just resumes, to close its choice point
+ */
+void QueryHandle::cancel() {
+    cancel_requested = true;
+    if (QueryExecutor::instance()->dequeue(this)) {
+        finish(Cancelled);
+        return;
+    }
+    QMutexLocker lk(&lock);
+    interrupt();
+}
+
+void QueryHandle::interrupt() {
+    if (suspended)
+        more.wakeAll();
+    else if (st == Running && thread_id > 0)
+        PL_thread_raise(thread_id, cancel_signal);
+}
+
+/** nobody can fetch() any more: don't keep a worker waiting for it
+ */
+void QueryHandle::release(QueryHandle *q) {
+    {   QMutexLocker lk(&q->lock);
+        if (q->serving) {
+            q->orphaned = true;
+            q->cancel_requested = true;
+            q->interrupt();
+            return;
+        }
+    }
+    delete q;
+}
+
+void QueryHandle::finish(State s, QString e) {
+    {   QMutexLocker lk(&lock);
+        st = s;
+        err = e;
+        thread_id = 0;
+        done.wakeAll();
+    }
+    emit completed(s);
+}
+
+/** a thread with a Prolog engine attached for its lifetime
+ */
+class QueryExecutor::worker : public QThread {
+public:
+    worker(QueryExecutor *x, int n) : x(x), n(n) {}
+
+    /** a thread of its own for a Pull query, ending with it */
+    worker(QueryExecutor *x, int n, QueryPtr pull) : x(x), n(n), pull(pull) {}
+
+protected:
+    virtual void run() {
+        SwiPrologEngine::wait_ready(ULONG_MAX);
+
+        PL_thread_attr_t attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.flags = PL_THREAD_NO_DEBUG;
+        QByteArray alias = QString(pull ? "__pull_%1" : "__query_%1").arg(n).toUtf8();
+        attr.alias = alias.data();
+        if (PL_thread_attach_engine(&attr) < 0) {
+            qDebug() << "QueryExecutor: can't attach engine" << alias;
+            if (pull) {
+                x->unlist(pull.data());
+                pull->finish(QueryHandle::Error, "no Prolog engine");
+                pull.clear();
+            }
+            return;
+        }
+
+        // don't keep a reference while serving: a dropped handle must cancel
+        if (pull)
+            x->serve(std::move(pull));
+        else
+            for (QueryPtr q; (q = x->next()); )
+                x->serve(std::move(q));
+
+        PL_thread_destroy_engine();
+    }
+
+private:
+    QueryExecutor *x;
+    int n;
+    QueryPtr pull;
+};
+
+QueryExecutor::QueryExecutor(int nworkers)
+    : stopping(false)
+{
+    for (int n = 0; n < nworkers; ++n) {
+        workers.append(new worker(this, n));
+        workers.last()->start();
+    }
+    QObject::connect(qApp, &QCoreApplication::aboutToQuit, [=]() { stop(); });
+}
+
+/** a couple of workers are enough to keep GUI requests off the toplevel
+ */
+QueryExecutor *QueryExecutor::instance() {
+    static QueryExecutor *x = [] {
+        qRegisterMetaType<QueryBindings>("QueryBindings");
+        qRegisterMetaType<QList<QueryBindings>>("QList<QueryBindings>");
+        return new QueryExecutor(qBound(2, QThread::idealThreadCount() / 2, 4));
+    }();
+    return x;
+}
+
+QueryPtr QueryExecutor::submit(QString goal, Priority p, QString module) {
+    return enqueue(QueryPtr(new QueryHandle(module, goal, pfunc(), p, QueryHandle::Collect, 64)));
+}
+
+QueryPtr QueryExecutor::stream(QString goal, int batch, Priority p, QString module) {
+    return enqueue(QueryPtr(new QueryHandle(module, goal, pfunc(), p, QueryHandle::Stream, batch)));
+}
+
+/** a Pull query keeps its engine while open: run it outside the pool,
+ *  so open handles can't starve other queries
+ */
+QueryPtr QueryExecutor::open(QString goal, Priority p, QString module) {
+    QueryPtr q(new QueryHandle(module, goal, pfunc(), p, QueryHandle::Pull, 64), QueryHandle::release);
+    static std::atomic<int> pulls;
+    auto w = new worker(this, pulls++, q);
+    QObject::connect(w, &QThread::finished, w, &QObject::deleteLater);
+    {   QMutexLocker lk(&lock);
+        if (stopping) {
+            delete w;
+            q->finish(QueryHandle::Cancelled);
+            return q;
+        }
+        pulling.insert(q.data());
+        for (int i = pullers.size() - 1; i >= 0; --i)
+            if (!pullers[i])
+                pullers.removeAt(i);
+        pullers.append(w);
+    }
+    w->start();
+    return q;
+}
+
+void QueryExecutor::unlist(QueryHandle *q) {
+    QMutexLocker lk(&lock);
+    pulling.remove(q);
+}
+
+QueryPtr QueryExecutor::submit(pfunc job, Priority p) {
+    return enqueue(QueryPtr(new QueryHandle(QString(), QString(), job, p, QueryHandle::Collect, 1)));
+}
+
+QueryPtr QueryExecutor::enqueue(QueryPtr q) {
+    QMutexLocker lk(&lock);
+    queues[q->priority].enqueue(q);
+    queued.wakeOne();
+    return q;
+}
+
+QueryPtr QueryExecutor::next() {
+    QMutexLocker lk(&lock);
+    for ( ; ; ) {
+        if (stopping)
+            return QueryPtr();
+        for (int p = 0; p < priorities; ++p)
+            if (!queues[p].isEmpty())
+                return queues[p].dequeue();
+        queued.wait(&lock);
+    }
+}
+
+bool QueryExecutor::dequeue(QueryHandle *q) {
+    QMutexLocker lk(&lock);
+    QQueue<QueryPtr> &Q = queues[q->priority];
+    for (int i = 0; i < Q.size(); ++i)
+        if (Q[i].data() == q) {
+            Q.removeAt(i);
+            return true;
+        }
+    return false;
+}
+
+void QueryExecutor::stop() {
+    QList<QPointer<QThread>> pulls;
+    {   QMutexLocker lk(&lock);
+        stopping = true;
+        queued.wakeAll();
+        foreach (QueryHandle *q, pulling) {
+            q->cancel_requested = true;
+            QMutexLocker lq(&q->lock);
+            q->interrupt();
+        }
+        pulls = pullers;
+    }
+    foreach (worker *w, workers)
+        w->wait(1000);
+    foreach (QPointer<QThread> w, pulls)
+        if (w)
+            w->wait(1000);
+}
+
+void QueryExecutor::cancel_handler(int sig) {
+    Q_UNUSED(sig)
+    if (current && current->cancel_requested) {
+        term_t ex = PL_new_term_ref();
+        PL_put_atom_chars(ex, "query_cancelled");
+        PL_raise_exception(ex);
+    }
+}
+
+/** a Pull query could wait for fetch() indefinitely: hold it weakly,
+ *  so that dropping the last QueryPtr cancels it
+ */
+void QueryExecutor::serve(QueryPtr p) {
+    QueryHandle *q = p.data();
+    if (q->mode == QueryHandle::Pull) {
+        {   QMutexLocker lk(&q->lock);
+            q->serving = true;
+        }
+        p.clear();
+    }
+
+    serve(q);
+
+    if (q->mode == QueryHandle::Pull) {
+        unlist(q);
+        {   QMutexLocker lk(&q->lock);
+            q->serving = false;
+            if (!q->orphaned)
+                return;
+        }
+        delete q;
+    }
+}
+
+/** parse text keeping variable names, then deliver each solution bindings
+ *  a batch is sent when full, or in Pull mode when the request is satisfied
+ */
+void QueryExecutor::serve(QueryHandle *q) {
+    static bool handler = PL_signal(cancel_signal|PL_SIGSYNC, cancel_handler) != SIG_ERR;
+    Q_UNUSED(handler)
+
+    {   QMutexLocker lk(&q->lock);
+        if (!q->cancel_requested) {
+            q->st = QueryHandle::Running;
+            q->thread_id = PL_thread_self();
+        }
+    }
+    if (q->state() != QueryHandle::Running) {
+        q->finish(QueryHandle::Cancelled);
+        return;
+    }
+    current = q;
+
+    QueryHandle::State s = QueryHandle::Failed;
+    QString e;
+    try {
+        PlFrame fr;
+        if (q->job) {
+            q->job();
+            s = QueryHandle::Succeeded;
+        }
+        else {
+            PlTerm_var goal, vars;
+            SwiPrologEngine::parse_goal(q->text, goal, vars);
+
+            bool pull = q->mode == QueryHandle::Pull;
+            QList<QueryBindings> batch;
+            PlQuery query(A(q->module).as_string(), "call", PlTermv(goal));
+            while (!q->cancel_requested && (!pull || q->wait_fetch()) && query.next_solution()) {
+                QueryBindings b = SwiPrologEngine::bindings(vars);
+                if (q->mode == QueryHandle::Collect) {
+                    QMutexLocker lk(&q->lock);
+                    q->sols.append(b);
+                }
+                batch.append(b);
+                bool full = batch.size() >= q->batch;
+                if (pull) {
+                    QMutexLocker lk(&q->lock);
+                    full = full || q->requested == 0;
+                }
+                if (full) {
+                    emit q->results(batch);
+                    batch.clear();
+                }
+                s = QueryHandle::Succeeded;
+            }
+            if (!batch.isEmpty())
+                emit q->results(batch);
+        }
+    }
+    catch(const PlException& ex) {
+        s = QueryHandle::Error;
+        e = t2w(ex.term());
+    }
+    catch(const PlFail&) {
+        s = QueryHandle::Failed;
+    }
+
+    current = 0;
+    if (q->cancel_requested)
+        s = QueryHandle::Cancelled;
+    q->finish(s, e);
+}
@@ -0,0 +1,203 @@
+/*  Part of SWI-Prolog interface to Qt
+
+    Author:        SWI-Prolog contributors
+    WWW:           https://www.swi-prolog.org
+    Copyright (c)  2026, SWI-Prolog contributors
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions
+    are met:
+
+    1. Redistributions of source code must retain the above copyright
+       notice, this list of conditions and the following disclaimer.
+
+    2. Redistributions in binary form must reproduce the above copyright
+       notice, this list of conditions and the following disclaimer in
+       the documentation and/or other materials provided with the
+       distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+    FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+    COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+    INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+    BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+    LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+    ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef QUERYEXECUTOR_H
+#define QUERYEXECUTOR_H
+
+#include "SwiPrologEngine.h"
+
+#include <QQueue>
+#include <QSet>
+#include <QPointer>
+#include <QSharedPointer>
+#include <atomic>
+#include <climits>
+
+class QueryExecutor;
+
+/** a query submitted to QueryExecutor, and its outcome
+ *
+ *  Signals are emitted from the worker thread: receivers in the GUI get them queued.
+ *  Solutions are delivered in batches, and depending on the mode:
+ *  - Collect: also kept, as a future: wait(), then read solutions()
+ *  - Stream:  only delivered, memory doesn't grow with the solutions count
+ *  - Pull:    computed only when asked by fetch(), the choice point
+ *             is kept - with a thread of its own, outside the pool -
+ *             until exhausted or cancelled
+ *             dropping the last QueryPtr cancels it
+ */
+class PQCONSOLESHARED_EXPORT QueryHandle : public QObject {
+    Q_OBJECT
+public:
+
+    enum State { Queued, Running, Succeeded, Failed, Error, Cancelled };
+    enum Mode { Collect, Stream, Pull };
+
+    QString goal() const { return text; }
+    State state() const;
+    bool finished() const { return state() > Running; }
+
+    /** block until finished, false on timeout */
+    bool wait(unsigned long msec = ULONG_MAX);
+
+    /** collected so far, in Collect mode */
+    QList<QueryBindings> solutions() const;
+
+    /** in Pull mode, compute up to <n> more solutions */
+    void fetch(int n);
+
+    /** exception text, when state() is Error */
+    QString error() const;
+
+    /** drop from queue, or raise in the thread running it */
+    void cancel();
+
+signals:
+
+    /** solutions found since last batch */
+    void results(QList<QueryBindings> batch);
+
+    /** final state reached */
+    void completed(int state);
+
+private:
+
+    friend class QueryExecutor;
+    QueryHandle(QString module, QString text, pfunc job, int priority, Mode mode, int batch);
+
+    QString module, text;
+    pfunc job;
+    int priority;
+    Mode mode;
+    int batch;
+
+    mutable QMutex lock;
+    QWaitCondition done;
+    State st;
+    QList<QueryBindings> sols;
+    QString err;
+
+    /** Pull mode: solutions asked and not yet computed, and worker waiting for fetch() */
+    int requested;
+    bool suspended;
+    QWaitCondition more;
+
+    /** Pull mode: block worker until asked, false if cancelled */
+    bool wait_fetch();
+
+    /** Pull mode: the worker doesn't own the handle, the last QueryPtr does
+     *  <serving> while the worker uses it, <orphaned> when dropped meanwhile
+     */
+    bool serving;
+    bool orphaned;
+
+    /** QueryPtr deleter: a served handle is cancelled, and deleted by its worker */
+    static void release(QueryHandle *q);
+
+    /** wake or raise in the worker, requires lock */
+    void interrupt();
+
+    /** Prolog thread serving, while Running */
+    int thread_id;
+    std::atomic<bool> cancel_requested;
+
+    void finish(State s, QString e = QString());
+};
+
+typedef QSharedPointer<QueryHandle> QueryPtr;
+
+/** run queries on a few threads with Prolog engines attached
+ *
+ *  Independent of the toplevel read loop: queries don't wait for a
+ *  console prompt, and run concurrently. Higher priority classes are
+ *  always served first.
+ */
+class PQCONSOLESHARED_EXPORT QueryExecutor {
+public:
+
+    enum Priority { Interactive, Normal, Background, priorities };
+
+    static QueryExecutor *instance();
+
+    /** parse and run goal text in module, collecting bindings of named variables */
+    QueryPtr submit(QString goal, Priority p = Normal, QString module = "user");
+
+    /** as submit, delivering solutions in batches of <batch>, not kept */
+    QueryPtr stream(QString goal, int batch, Priority p = Normal, QString module = "user");
+
+    /** as submit, solutions are computed on request: see QueryHandle::fetch()
+     *  runs on its own thread, priority doesn't apply
+     */
+    QueryPtr open(QString goal, Priority p = Normal, QString module = "user");
+
+    /** run arbitrary code, with an engine attached */
+    QueryPtr submit(pfunc job, Priority p = Normal);
+
+private:
+
+    explicit QueryExecutor(int nworkers);
+
+    class worker;
+    friend class worker;
+    friend class QueryHandle;
+    QList<worker*> workers;
+
+    QMutex lock;
+    QWaitCondition queued;
+    QQueue<QueryPtr> queues[priorities];
+    bool stopping;
+
+    /** Pull queries open, and their threads: cancelled on stop() */
+    QSet<QueryHandle*> pulling;
+    QList<QPointer<QThread>> pullers;
+    void unlist(QueryHandle *q);
+
+    QueryPtr enqueue(QueryPtr q);
+
+    /** block until a query is available, null when stopping */
+    QueryPtr next();
+
+    /** run <q> in calling worker */
+    void serve(QueryPtr p);
+    void serve(QueryHandle *q);
+
+    /** drop a queued query, false if already taken by a worker */
+    bool dequeue(QueryHandle *q);
+
+    void stop();
+
+    /** installed as PL_SIGSYNC handler, raise in query being cancelled */
+    static void cancel_handler(int sig);
+};
+
+#endif // QUERYEXECUTOR_H
@@ -0,0 +1,112 @@
+/*  Part of SWI-Prolog interface to Qt
+
+    Author:        SWI-Prolog contributors
+    WWW:           https://www.swi-prolog.org
+    Copyright (c)  2026, SWI-Prolog contributors
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions
+    are met:
+
+    1. Redistributions of source code must retain the above copyright
+       notice, this list of conditions and the following disclaimer.
+
+    2. Redistributions in binary form must reproduce the above copyright
+       notice, this list of conditions and the following disclaimer in
+       the documentation and/or other materials provided with the
+       distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+    FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+    COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+    INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+    BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+    LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+    ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "RepaintScheduler.h"
+#include "ConsoleEdit.h"
+#include <QApplication>
+
+RepaintScheduler::RepaintScheduler()
+    : hz(60), period(0)
+{
+    budget = 1000 / hz / 2;
+}
+
+/** could be first accessed from a Prolog thread, by console_settings/1
+ */
+RepaintScheduler *RepaintScheduler::instance() {
+    static RepaintScheduler *s = [] {
+        auto r = new RepaintScheduler;
+        r->moveToThread(qApp->thread());
+        return r;
+    }();
+    return s;
+}
+
+/** takes effect on next frame
+ */
+void RepaintScheduler::setRate(int v) {
+    hz = qBound(1, v, 240);
+}
+
+void RepaintScheduler::post(ConsoleEdit *c) {
+    if (!pending.contains(c))
+        pending.append(c);
+    if (!frame.isActive()) {
+        period = 1000 / hz;
+        frame.start(period, Qt::PreciseTimer, this);
+        last.start();
+    }
+}
+
+void RepaintScheduler::remove(ConsoleEdit *c) {
+    pending.removeAll(c);
+}
+
+/** serve pending consoles, then adjust the budget
+ *  a frame coming late means display (layout, paint) cost more than
+ *  we left to it: shrink the share spent appending, else let it grow
+ */
+void RepaintScheduler::timerEvent(QTimerEvent *e) {
+    if (e->timerId() != frame.timerId()) {
+        QObject::timerEvent(e);
+        return;
+    }
+
+    if (last.restart() > period + period / 2)
+        budget = qMax(1, budget * 3 / 4);
+    else
+        budget = qMin(period * 3 / 4, budget + 1);
+
+    if (period != 1000 / hz) {
+        period = 1000 / hz;
+        budget = qMin(budget, period * 3 / 4);
+        frame.start(period, Qt::PreciseTimer, this);
+    }
+
+    QList<ConsoleEdit*> serve;
+    serve.swap(pending);
+
+    QList<ConsoleEdit*> active;
+    foreach (ConsoleEdit *c, serve)
+        if (c->isVisible() || c->output_blocked())
+            active.append(c);
+        // else parked: showEvent will post it again
+
+    int slice = active.isEmpty() ? 0 : qMax(1, budget / active.size());
+    foreach (ConsoleEdit *c, active)
+        if (c->drain_output(slice))
+            pending.append(c);
+
+    if (pending.isEmpty())
+        frame.stop();
+}
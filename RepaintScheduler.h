@@ -0,0 +1,89 @@
+/*  Part of SWI-Prolog interface to Qt
+
+    Author:        SWI-Prolog contributors
+    WWW:           https://www.swi-prolog.org
+    Copyright (c)  2026, SWI-Prolog contributors
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions
+    are met:
+
+    1. Redistributions of source code must retain the above copyright
+       notice, this list of conditions and the following disclaimer.
+
+    2. Redistributions in binary form must reproduce the above copyright
+       notice, this list of conditions and the following disclaimer in
+       the documentation and/or other materials provided with the
+       distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+    FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+    COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+    INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+    BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+    LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+    ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef REPAINTSCHEDULER_H
+#define REPAINTSCHEDULER_H
+
+#include "pqConsole_global.h"
+
+#include <QObject>
+#include <QBasicTimer>
+#include <QElapsedTimer>
+#include <QList>
+#include <atomic>
+
+class ConsoleEdit;
+
+/** paces output display of all consoles on a single frame timer
+ *
+ *  Consoles with output ready are queued here, and served once per
+ *  frame, sharing a time budget adapted to how late frames come.
+ *  Hidden consoles are parked until shown, unless their writers
+ *  are blocked on a full backlog.
+ *  Lives in GUI thread.
+ */
+class PQCONSOLESHARED_EXPORT RepaintScheduler : public QObject {
+    Q_OBJECT
+public:
+
+    static RepaintScheduler *instance();
+
+    /** console has output to display */
+    void post(ConsoleEdit *c);
+
+    /** console is going away */
+    void remove(ConsoleEdit *c);
+
+    /** frames per second */
+    int rate() const { return hz; }
+    void setRate(int v);
+
+protected:
+
+    virtual void timerEvent(QTimerEvent *e);
+
+private:
+
+    RepaintScheduler();
+
+    QBasicTimer frame;
+    QList<ConsoleEdit*> pending;
+    std::atomic<int> hz;
+    int period;
+
+    /** msecs to spend appending per frame, and when last frame started */
+    int budget;
+    QElapsedTimer last;
+};
+
+#endif // REPAINTSCHEDULER_H
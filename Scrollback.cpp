@@ -0,0 +1,277 @@
+/*  Part of SWI-Prolog interface to Qt
+
+    Author:        SWI-Prolog contributors
+    WWW:           https://www.swi-prolog.org
+    Copyright (c)  2026, SWI-Prolog contributors
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions
+    are met:
+
+    1. Redistributions of source code must retain the above copyright
+       notice, this list of conditions and the following disclaimer.
+
+    2. Redistributions in binary form must reproduce the above copyright
+       notice, this list of conditions and the following disclaimer in
+       the documentation and/or other materials provided with the
+       distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+    FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+    COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+    INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+    BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+    LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+    ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "Scrollback.h"
+#include <QDataStream>
+#include <QDebug>
+#include <algorithm>
+
+Scrollback::Scrollback()
+    : spill(0),
+      memory_limit(0),
+      spill_wait(0),
+      spill_backoff(0),
+      last_format(-1),
+      nlines(0),
+      nbytes(0)
+{
+}
+
+Scrollback::~Scrollback() {
+    delete spill;
+}
+
+/** forget everything
+ */
+void Scrollback::clear() {
+    chunks.clear();
+    spilled_chunks.clear();
+    delete spill;
+    spill = 0;
+    spill_wait = spill_backoff = 0;
+    formats.clear();
+    last_format = -1;
+    nlines = 0;
+    nbytes = 0;
+}
+
+qint64 Scrollback::spilledBytes() const {
+    return spilled_chunks.isEmpty() ? 0 : spilled_chunks.last().off + spilled_chunks.last().size;
+}
+
+void Scrollback::setMemoryLimit(qint64 limit) {
+    memory_limit = limit;
+    spill_out();
+}
+
+/** move oldest chunks to disk while over limit
+ *  the newest chunk, still filling, always stays in memory
+ *  on file error keep in memory rather than lose lines, and retry
+ *  after a growing number of new chunks
+ */
+void Scrollback::spill_out() {
+    while (memory_limit > 0 && nbytes > memory_limit && chunks.size() > 1 && spill_wait == 0) {
+        if (!spill) {
+            spill = new QTemporaryFile;
+            if (!spill->open()) {
+                qDebug() << "scrollback spill:" << spill->errorString();
+                delete spill;
+                spill = 0;
+                spill_failed();
+                return;
+            }
+        }
+
+        const chunk &k = chunks.first();
+        QByteArray buf;
+        {   QDataStream out(&buf, QIODevice::WriteOnly);
+            out << k.text << k.line_end << qint32(k.runs.size());
+            foreach (const style_run &r, k.runs)
+                out << qint32(r.off) << qint32(r.len) << qint32(r.format);
+        }
+
+        qint64 off = spilledBytes();
+        if (!spill->seek(off) || spill->write(buf) != buf.size() || !spill->flush()) {
+            qDebug() << "scrollback spill:" << spill->errorString();
+            spill->resize(off);
+            spill_failed();
+            return;
+        }
+        spill_backoff = 0;
+
+        spilled_chunks.append(spilled {off, buf.size(), k.line_end.size()});
+        nbytes -= k.bytes();
+        chunks.removeFirst();
+    }
+}
+
+void Scrollback::spill_failed() {
+    spill_backoff = qBound(1, spill_backoff * 2, 64);
+    spill_wait = spill_backoff;
+}
+
+/** read back a chunk from disk, through a transient map
+ *  if the map is refused (address space, descriptor limits), read it plainly
+ */
+bool Scrollback::spill_in(const spilled &s, chunk &k) {
+    QByteArray buf;
+    uchar *p = spill->map(s.off, s.size);
+    if (p)
+        buf = QByteArray::fromRawData(reinterpret_cast<const char*>(p), int(s.size));
+    else if (!spill->seek(s.off) || (buf = spill->read(s.size)).size() != s.size)
+        return false;
+
+    QDataStream in(buf);
+    qint32 n;
+    in >> k.text >> k.line_end >> n;
+    k.runs.resize(n);
+    for (int i = 0; i < n; ++i) {
+        qint32 off, len, format;
+        in >> off >> len >> format;
+        k.runs[i] = style_run {off, len, format};
+    }
+
+    if (p)
+        spill->unmap(p);
+    return in.status() == QDataStream::Ok;
+}
+
+int Scrollback::intern(const QTextCharFormat &f) {
+    if (last_format >= 0 && formats[last_format] == f)
+        return last_format;
+    for (int i = 0; i < formats.size(); ++i)
+        if (formats[i] == f)
+            return last_format = i;
+    formats.append(f);
+    return last_format = formats.size() - 1;
+}
+
+/** copy a block content - text and formats - as the newest line
+ */
+void Scrollback::append(const QTextBlock &b) {
+    if (chunks.isEmpty() || chunks.last().line_end.size() == chunk_lines) {
+        chunks.append(chunk());
+        if (spill_wait > 0)
+            --spill_wait;
+    }
+
+    chunk &k = chunks.last();
+    nbytes -= k.bytes();
+
+    // runs never span lines
+    int bol = k.text.size();
+    for (QTextBlock::iterator i = b.begin(); !i.atEnd(); ++i) {
+        QTextFragment f = i.fragment();
+        if (f.isValid() && f.length() > 0) {
+            int off = k.text.size(), format = intern(f.charFormat());
+            k.text += f.text();
+            if (off > bol && k.runs.last().format == format)
+                k.runs.last().len += f.length();
+            else
+                k.runs.append(style_run {off, f.length(), format});
+        }
+    }
+    k.line_end.append(k.text.size());
+
+    nbytes += k.bytes();
+    ++nlines;
+
+    spill_out();
+}
+
+/** insert the newest chunk of lines at cursor, removing it from store
+ *  a chunk unreadable from disk is replaced by a line reporting the loss:
+ *  older chunks stay reachable
+ */
+int Scrollback::restore(QTextCursor &c) {
+    chunk k;
+    if (!chunks.isEmpty()) {
+        k = chunks.takeLast();
+        nbytes -= k.bytes();
+    }
+    else if (!spilled_chunks.isEmpty()) {
+        spilled s = spilled_chunks.takeLast();
+        if (!spill_in(s, k)) {
+            qDebug() << "scrollback restore:" << spill->errorString();
+            k = chunk();
+            k.text = QString("[%1 lines of scrollback lost: %2]").arg(s.lines).arg(spill->errorString());
+            k.line_end.append(k.text.size());
+            k.runs.append(style_run {0, k.text.size(), intern(QTextCharFormat())});
+            nlines -= s.lines - 1;
+        }
+        // chunks are appended and popped at the file tail only
+        spill->resize(s.off);
+    }
+    else
+        return 0;
+
+    nlines -= k.line_end.size();
+
+    int at = c.position();
+    c.beginEditBlock();
+    int r = 0;
+    foreach (int end, k.line_end) {
+        for ( ; r < k.runs.size() && k.runs[r].off < end; ++r) {
+            const style_run &s = k.runs[r];
+            c.insertText(k.text.mid(s.off, s.len), formats[s.format]);
+        }
+        c.insertBlock();
+    }
+    c.endEditBlock();
+    c.setPosition(at);
+
+    return k.line_end.size();
+}
+
+/** last line in chunk containing <t>, -1 if none
+ *  text is stored without separators: skip matches across lines
+ */
+static int last_line_matching(const QString &text, const QVector<int> &line_end, const QString &t, Qt::CaseSensitivity cs) {
+    for (int from = -1; ; ) {
+        int p = text.lastIndexOf(t, from, cs);
+        if (p < 0)
+            return -1;
+        int l = int(std::upper_bound(line_end.begin(), line_end.end(), p) - line_end.begin());
+        if (p + t.size() <= line_end[l])
+            return l;
+        if (p == 0)
+            return -1;
+        from = p - 1;
+    }
+}
+
+/** look for text, newest lines first - on disk chunks are mapped one at time
+ */
+int Scrollback::search(const QString &text, Qt::CaseSensitivity cs) {
+    if (text.isEmpty())
+        return 0;
+
+    int depth = 0;
+    for (int i = chunks.size() - 1; i >= 0; --i) {
+        const chunk &k = chunks[i];
+        int l = last_line_matching(k.text, k.line_end, text, cs);
+        if (l >= 0)
+            return depth + k.line_end.size() - l;
+        depth += k.line_end.size();
+    }
+    for (int i = spilled_chunks.size() - 1; i >= 0; --i) {
+        chunk k;
+        if (spill_in(spilled_chunks[i], k)) {
+            int l = last_line_matching(k.text, k.line_end, text, cs);
+            if (l >= 0)
+                return depth + k.line_end.size() - l;
+        }
+        depth += spilled_chunks[i].lines;
+    }
+    return 0;
+}
@@ -0,0 +1,145 @@
+/*  Part of SWI-Prolog interface to Qt
+
+    Author:        SWI-Prolog contributors
+    WWW:           https://www.swi-prolog.org
+    Copyright (c)  2026, SWI-Prolog contributors
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions
+    are met:
+
+    1. Redistributions of source code must retain the above copyright
+       notice, this list of conditions and the following disclaimer.
+
+    2. Redistributions in binary form must reproduce the above copyright
+       notice, this list of conditions and the following disclaimer in
+       the documentation and/or other materials provided with the
+       distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+    FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+    COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+    INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+    BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+    LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+    ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef SCROLLBACK_H
+#define SCROLLBACK_H
+
+#include "pqConsole_global.h"
+
+#include <QList>
+#include <QVector>
+#include <QTextBlock>
+#include <QTextCursor>
+#include <QTextCharFormat>
+#include <QTemporaryFile>
+
+/** append-only store of console lines evicted from the document
+ *
+ *  The console document keeps a bounded window of live lines, so layout
+ *  cost depends on the window, not on the history. Older lines are kept
+ *  here in chunks of plain text with style runs: memory is proportional
+ *  to the bytes stored. They are paged back in on top of the document
+ *  when the user scrolls there.
+ *
+ *  Beyond memoryLimit() bytes, the oldest chunks spill to an append-only
+ *  temporary file, and are read back through a memory map when needed.
+ */
+class PQCONSOLESHARED_EXPORT Scrollback {
+public:
+
+    /** lines moved in/out together */
+    enum { chunk_lines = 256 };
+
+    Scrollback();
+    ~Scrollback();
+
+    /** copy a block content - text and formats - as the newest line */
+    void append(const QTextBlock &b);
+
+    /** insert the newest chunk of lines at cursor, removing it from store
+     *  the cursor is left before them: the next, older chunk goes on top
+     *  return the number of lines restored
+     */
+    int restore(QTextCursor &c);
+
+    /** lines stored, in memory or on disk */
+    int lines() const { return nlines; }
+
+    /** text and runs held in memory, in bytes */
+    qint64 bytes() const { return nbytes; }
+
+    /** bytes spilled to disk */
+    qint64 spilledBytes() const;
+
+    /** memory kept before spilling older chunks to disk - 0 to never spill */
+    qint64 memoryLimit() const { return memory_limit; }
+    void setMemoryLimit(qint64 limit);
+
+    /** look for text, newest lines first
+     *  return how many lines from the newest one must be restored to get it, 0 if not found
+     */
+    int search(const QString &text, Qt::CaseSensitivity cs = Qt::CaseInsensitive);
+
+    /** forget everything */
+    void clear();
+
+private:
+
+    /** stretch of text sharing a format, index in <formats> */
+    struct style_run {
+        int off, len, format;
+    };
+
+    /** a group of lines, text without separators */
+    struct chunk {
+        QString text;
+        QVector<int> line_end;
+        QVector<style_run> runs;
+
+        qint64 bytes() const {
+            return text.size() * qint64(sizeof(QChar)) +
+                   line_end.size() * qint64(sizeof(int)) +
+                   runs.size() * qint64(sizeof(style_run));
+        }
+    };
+    QList<chunk> chunks;
+
+    /** chunk stored in <spill> file, older than any in <chunks> */
+    struct spilled {
+        qint64 off, size;
+        int lines;
+    };
+    QVector<spilled> spilled_chunks;
+    QTemporaryFile *spill;
+    qint64 memory_limit;
+
+    /** move oldest chunks to disk while over limit */
+    void spill_out();
+
+    /** after a file error, new chunks to wait before spilling again, and next wait */
+    int spill_wait, spill_backoff;
+    void spill_failed();
+
+    /** read back a chunk from disk */
+    bool spill_in(const spilled &s, chunk &k);
+
+    /** distinct formats are few in a console: linear intern is fine */
+    QVector<QTextCharFormat> formats;
+    int last_format;
+    int intern(const QTextCharFormat &f);
+
+    int nlines;
+    qint64 nbytes;
+};
+
+#endif // SCROLLBACK_H
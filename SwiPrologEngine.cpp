@@ -51,10 +51,13 @@ SwiPrologEngine *SwiPrologEngine::spe;
 SwiPrologEngine::SwiPrologEngine(ConsoleEdit *target, QObject *parent)
     : QThread(parent),
       FlushOutputEvents(target),
-      argc(-1)
+      argc(-1),
+      signalled(false),
+      query_batch(256)
 {
     Q_ASSERT(spe == 0);
     spe = this;
+    qRegisterMetaType<QList<QueryBindings>>("QList<QueryBindings>");
 }
 
 /** enforce proper termination sequence
@@ -80,10 +83,35 @@ void SwiPrologEngine::start(int argc, char **argv) {
 }
 
 /** from console front end: user - or a equivalent actor - has input s
+ *  queued after unread input, if any (typeahead)
  */
 void SwiPrologEngine::user_input(QString s) {
     QMutexLocker lk(&sync);
-    buffer = s.toUtf8();
+    input.push(s.toUtf8());
+    ready.wakeAll();
+}
+
+bool SwiPrologEngine::feed_input(const QByteArray &chunk) {
+    // called from a GUI timer: if the reader is busy, retry on next tick
+    if (!sync.tryLock())
+	return false;
+    bool done = input.offer(chunk);
+    if (done)
+	ready.wakeAll();
+    sync.unlock();
+    return done;
+}
+
+void SwiPrologEngine::wake() {
+    QMutexLocker lk(&sync);
+    signalled = true;
+    ready.wakeAll();
+}
+
+void SwiPrologEngine::feeding(bool on) {
+    QMutexLocker lk(&sync);
+    input.feeding = on;
+    ready.wakeAll();
 }
 
 /** fill the buffer
@@ -95,70 +123,105 @@ ssize_t SwiPrologEngine::_read_(void *handle, char *buf, size_t bufsize) {
 }
 
 /** background read & query loop
+ *  sleep until input or a query arrive, or wake() reports a signal
+ *  signals raised by other Prolog threads are checked every signal_poll msecs
  */
 ssize_t SwiPrologEngine::_read_(char *buf, size_t bufsize) {
 
-    if ( buffer.isEmpty() )
+    bool prompt;
+    {   QMutexLocker lk(&sync);
+	prompt = input.empty() && !input.feeding;
+    }
+    if (prompt)
 	emit user_prompt(PL_thread_self(), is_tty(this));
 
     for ( ; ; ) {
 
+	QList<query> serve;
 	{   QMutexLocker lk(&sync);
 
 	    if (!spe) // terminated
 		return 0;
 
 	    if (!queries.empty())
-		serve_query(queries.takeFirst());
-
-	    uint n = buffer.length();
-	    if (n > 0) {
-		uint l = bufsize < n ? bufsize : n;
-		memcpy(buf, buffer, l);
-		buffer.remove(0, l);
-		return l;
-	    }
-
-	    if (target->status == ConsoleEdit::eof) {
-		target->status = ConsoleEdit::running;
-		return 0;
+		serve.append(queries.takeFirst());
+	    else {
+		if (!input.empty())
+		    return input.read(buf, bufsize);
+
+		if (target->status == ConsoleEdit::eof) {
+		    target->status = ConsoleEdit::running;
+		    return 0;
+		}
+
+		if (!signalled)
+		    ready.wait(&sync, signal_poll);
 	    }
+	    signalled = false;
 	}
 
+	// don't hold <sync>: the query could read, and the GUI must not wait for it
+	if (!serve.empty())
+	    serve_query(serve.first());
+
 	if (PL_handle_signals() < 0)
 	    return -1;
-
-	msleep(100);
     }
 }
 
 /** async query interface served from same thread
+ *  solutions are sent in batches of query_batch
  */
 void SwiPrologEngine::serve_query(query p) {
     Q_ASSERT(!p.is_script);
     QString n = p.name, t = p.text;
     try {
-	if (n.isEmpty()) {
-	    PlQuery q("call", PlTermv(PlCompound(std::string(t.toUtf8()), PlEncoding::UTF8)));
-	    //PlQuery q("call", PlTermv(PlCompound(t.toStdWString().data())));
-	    int occurrences = 0;
-	    while (q.next_solution())
-		emit query_result(t, ++occurrences);
-	    emit query_complete(t, occurrences);
-	}
-	else {
-	    PlQuery q(A(n).as_string(), "call", PlTermv(PlCompound(std::string(t.toUtf8()), PlEncoding::UTF8)));
-	    //PlQuery q(A(n), "call", PlTermv(PlCompound(t.toStdWString().data())));
-	    int occurrences = 0;
-	    while (q.next_solution())
-		emit query_result(t, ++occurrences);
-	    emit query_complete(t, occurrences);
+	PlFrame fr;
+	PlTerm_var goal, vars;
+	parse_goal(t, goal, vars);
+
+	PlQuery q(A(n.isEmpty() ? QString("user") : n).as_string(), "call", PlTermv(goal));
+	QList<QueryBindings> batch;
+	int occurrences = 0;
+	while (q.next_solution()) {
+	    batch.append(bindings(vars));
+	    emit query_result(t, ++occurrences);
+	    if (batch.size() >= query_batch) {
+		emit query_results(t, batch);
+		batch.clear();
+	    }
 	}
+	if (!batch.isEmpty())
+	    emit query_results(t, batch);
+	emit query_complete(t, occurrences);
     }
     catch(const PlException& ex) {
 	qDebug() << t << CCP(ex);
 	emit query_exception(n, CCP(ex));
     }
+    catch(const PlFail&) {
+	emit query_complete(t, 0);
+    }
+}
+
+/** parse keeping variable names, as read_term(Goal, [variable_names(Vars)])
+ */
+void SwiPrologEngine::parse_goal(QString text, PlTerm goal, PlTerm vars) {
+    PlTerm_var opts;
+    PlTerm_tail l(opts);
+    PlCheckFail(l.append(PlCompound("variable_names", PlTermv(vars))));
+    PlCheckFail(l.close());
+    PlCheckFail(PlCall("term_string", PlTermv(goal, PlTerm_atom(A(text)), opts)));
+}
+
+/** values written quoted, as the toplevel would show them
+ */
+QueryBindings SwiPrologEngine::bindings(PlTerm vars) {
+    QueryBindings b;
+    PlTerm_var nv;
+    for (PlTerm_tail t(vars); t.next(nv); )
+	b[t2w(nv[1])] = serialize(nv[2]);
+    return b;
 }
 
 /** empty the buffer
@@ -166,9 +229,8 @@ void SwiPrologEngine::serve_query(query p) {
 ssize_t SwiPrologEngine::_write_(void *handle, char *buf, size_t bufsize) {
     Q_UNUSED(handle);
     if (spe) {   // not terminated?
-	emit spe->user_output(QString::fromUtf8(buf, bufsize));
-	if (spe->target->status == ConsoleEdit::running)
-	    spe->flush();
+	spe->write(buf, bufsize);
+	spe->flush();
     }
     return bufsize;
 }
@@ -240,9 +302,7 @@ void SwiPrologEngine::run() {
     PL_exit_hook(halt_engine, NULL);
 
     PL_initialise(argc, argv);
-
-    // use as initialized flag
-    argc = 0;
+    set_ready();
 
     /*
     PL_toplevel();
@@ -272,6 +332,7 @@ void SwiPrologEngine::run() {
 void SwiPrologEngine::query_run(QString text) {
     QMutexLocker lk(&sync);
     queries.append(query {false, "", text});
+    ready.wakeAll();
 }
 
 /** push a named query, thus unlocking the execution polling loop
@@ -279,52 +340,142 @@ void SwiPrologEngine::query_run(QString text) {
 void SwiPrologEngine::query_run(QString module, QString text) {
     QMutexLocker lk(&sync);
     queries.append(query {false, module, text});
+    ready.wakeAll();
 }
 
 /** allows to run a delayed script from resource at startup
+ *  run as soon as the engine is ready
  */
 void SwiPrologEngine::script_run(QString name, QString text) {
-    queries.append(query {true, name, text});
-    QTimer::singleShot(100, this, SLOT(awake()));
+    QMutexLocker lk(&sync);
+    scripts.append(query {true, name, text});
+    if (is_ready())
+	QMetaObject::invokeMethod(this, "awake", Qt::QueuedConnection);
 }
 void SwiPrologEngine::awake() {
-    Q_ASSERT(queries.count() == 1);
-    query p = queries.takeFirst();
-    Q_ASSERT(!p.name.isEmpty());
-    in_thread I;
-    if (!I.named_load(p.name, p.text))
-	qDebug() << "awake failed";
+    for ( ; ; ) {
+	query p;
+	{   QMutexLocker lk(&sync);
+	    if (scripts.isEmpty())
+		return;
+	    p = scripts.takeFirst();
+	}
+	Q_ASSERT(!p.name.isEmpty());
+	in_thread I;
+	if (!I || !I.named_load(p.name, p.text))
+	    qDebug() << "awake failed";
+    }
 }
 
-/** Create a Prolog thread for the GUI thread, so we can call Prolog
-    goals.  These engines are created to deal with call-backs from the
-    gui and destroyed after the callback has finished. This is used only
-    if the thread associated to the current tab is not running a query.
+/** readiness latch, set once PL_initialise returns
  */
-SwiPrologEngine::in_thread::in_thread()
-    : frame(0)
-{
-    PL_thread_attr_t attr;
+static QMutex ready_sync;
+static QWaitCondition ready_done;
+static bool ready_flag;
 
-    while (!spe)
-	msleep(100);
-    while (!spe->isRunning())
-	msleep(100);
-    while (spe->argc)
-	msleep(100);
+bool SwiPrologEngine::is_ready() {
+    QMutexLocker lk(&ready_sync);
+    return ready_flag;
+}
+
+/** block until the main engine has completed PL_initialise
+ */
+bool SwiPrologEngine::wait_ready(unsigned long msec) {
+    QMutexLocker lk(&ready_sync);
+    while (!ready_flag)
+	if (!ready_done.wait(&ready_sync, msec)) {
+	    qDebug() << "Prolog engine not ready after" << msec << "ms";
+	    return false;
+	}
+    return true;
+}
+
+/** open the latch, then run scripts queued meanwhile
+ */
+void SwiPrologEngine::set_ready() {
+    {   QMutexLocker lk(&ready_sync);
+	ready_flag = true;
+	ready_done.wakeAll();
+    }
+    QMetaObject::invokeMethod(this, "awake", Qt::QueuedConnection);
+}
+
+/** idle engines, and how many to keep
+ */
+static QMutex engines_sync;
+static QList<PL_engine_t> engines;
+enum { engines_idle_max = 4 };
 
+/** creating an engine allocates stacks: reuse them
+ */
+PL_engine_t SwiPrologEngine::borrow_engine() {
+    {   QMutexLocker lk(&engines_sync);
+	if (!engines.isEmpty())
+	    return engines.takeLast();
+    }
+
+    PL_thread_attr_t attr;
     memset(&attr, 0, sizeof(attr));
     attr.flags = PL_THREAD_NO_DEBUG;
-    attr.alias = (char*)"__gui";
+    return PL_create_engine(&attr);
+}
+
+void SwiPrologEngine::return_engine(PL_engine_t e) {
+    {   QMutexLocker lk(&engines_sync);
+	if (engines.size() < engines_idle_max) {
+	    engines.append(e);
+	    return;
+	}
+    }
+    PL_destroy_engine(e);
+}
+
+/** Bind a Prolog engine to the GUI thread, so we can call Prolog
+    goals.  These engines are borrowed to deal with call-backs from the
+    gui and returned after the callback has finished. This is used only
+    if the thread associated to the current tab is not running a query.
+ */
+SwiPrologEngine::in_thread::in_thread()
+    : frame(0), engine(0), previous(0), tainted(false)
+{
+    if (!wait_ready())
+	return;
 
-    int id = PL_thread_attach_engine(&attr);
-    Q_ASSERT(id >= 0);			/* JW: Should throw exception */
+    if (PL_thread_self() < 0) {
+	engine = borrow_engine();
+	Q_ASSERT(engine);		/* JW: Should throw exception */
+	PL_set_engine(engine, &previous);
+    }
     frame = new PlFrame;
 }
 
+/** leave the engine clean for next user: undo bindings, restore I/O
+ *  an engine left with an exception could hold anything: don't reuse it
+ */
 SwiPrologEngine::in_thread::~in_thread() {
+    if (engine) {
+	frame->rewind();
+	if (PL_exception(0))
+	    tainted = true;
+	PL_clear_exception();
+	if (!tainted)
+	    try {
+		if (!PlCall("set_output", PlTermv(PlTerm_atom("user_output"))) ||
+		    !PlCall("set_input", PlTermv(PlTerm_atom("user_input"))))
+		    tainted = true;
+	    }
+	    catch(...) {
+		tainted = true;
+	    }
+    }
     delete frame;
-    PL_thread_destroy_engine();
+    if (engine) {
+	PL_set_engine(previous, 0);
+	if (tainted)
+	    PL_destroy_engine(engine);
+	else
+	    return_engine(engine);
+    }
 }
 
 /** run script <t>, named <n> in current thread
@@ -50,7 +50,12 @@
 /** 1. attempt to run generic code inter threads */
 typedef std::function<void()> pfunc;
 
+/** a solution: variable name -> value, written quoted */
+typedef QMap<QString, QString> QueryBindings;
+Q_DECLARE_METATYPE(QueryBindings)
+
 #include "FlushOutputEvents.h"
+#include "InputQueue.h"
 #include "pqConsole_global.h"
 
 /** interface IO running SWI Prolog engine in background
@@ -72,18 +77,49 @@ public:
     /** run script on background thread */
     void script_run(QString name, QString text);
 
-    /** start/stop a Prolog engine in thread - use for syncronized GUI */
+    /** borrow/return a Prolog engine for thread - use for syncronized GUI
+     *  if the thread has an engine already (nested use), just open a frame
+     *  a borrowed engine goes back to the pool with bindings undone and
+     *  current I/O reset, unless an exception or discard() taints it
+     */
     struct PQCONSOLESHARED_EXPORT in_thread {
         in_thread();
         ~in_thread();
 
+        /** the goal left thread state behind (flags, globals, thread id bound):
+         *  destroy the engine instead of pooling it
+         */
+        void discard() { tainted = true; }
+
         /** run named <n> script <t> in current thread */
         bool named_load(QString name, QString script, bool silent = true);
 
+        /** false if the engine didn't come up in time: don't call Prolog */
+        operator bool() const { return frame != 0; }
+
     private:
         PlFrame *frame;
+        PL_engine_t engine, previous;
+        bool tainted;
     };
 
+    /** engines kept ready for in_thread, created on demand */
+    static PL_engine_t borrow_engine();
+    static void return_engine(PL_engine_t e);
+
+    /** block until the main engine has completed PL_initialise, false on timeout */
+    static bool wait_ready(unsigned long msec = 30000);
+    static bool is_ready();
+
+    /** parse goal text, unifying <vars> with the Name=Var list of named variables */
+    static void parse_goal(QString text, PlTerm goal, PlTerm vars);
+
+    /** current values of named variables */
+    static QueryBindings bindings(PlTerm vars);
+
+    /** solutions delivered together by query_results */
+    void set_query_batch(int n) { query_batch = qMax(1, n); }
+
     /** handle application quit request in thread that started PL_toplevel */
     static bool quit_request();
 
@@ -93,17 +129,33 @@ public:
     /** query engine about expected interface */
     static bool is_tty(const FlushOutputEvents *target = 0);
 
-signals:
+    /** wake up the read loop, after raising a signal */
+    void wake();
+
+    /** streamed paste: append if there is room */
+    bool feed_input(const QByteArray &chunk);
 
-    /** issued to queue a string to user output */
-    void user_output(QString output);
+    /** streamed paste: more input is coming, or done */
+    void feeding(bool on);
+
+    /** longest a reader waits without checking Prolog signals, in msecs
+     *  only signals not reported by wake() - as thread_signal/2 - wait for it
+     */
+    enum { signal_poll = 250 };
+
+signals:
 
     /** issued to peek input - til to CR - from user */
     void user_prompt(int threadId, bool tty);
 
-    /** signal a query result */
+    /** signal a query result
+     *  deprecated: query_results also delivers the bindings
+     */
     void query_result(QString query, int occurrence);
 
+    /** signal a batch of query results */
+    void query_results(QString query, QList<QueryBindings> solutions);
+
     /** signal query completed */
     void query_complete(QString query, int tot_occurrences);
 
@@ -112,12 +164,12 @@ signals:
 
 public slots:
 
-    /** store string in buffer */
+    /** queue string on input */
     void user_input(QString input);
 
 protected:
 
-    // run a polling loop on buffer and queries
+    // run a blocking loop on input and queries
     virtual void run();
 
     int argc;
@@ -131,10 +183,14 @@ protected:
     };
 
     QMutex sync;
-    QByteArray buffer;      // syncronized !
+    InputQueue input;       // syncronized !
     QList<query> queries;   // syncronized !
+    QList<query> scripts;   // syncronized ! run from GUI when ready
+    QWaitCondition ready;   // input or queries changed
+    bool signalled;         // syncronized ! wake() called, PL_handle_signals() pending
 
     void serve_query(query q);
+    int query_batch;
 
     static ssize_t _read_(void *handle, char *buf, size_t bufsize);
     static ssize_t _write_(void *handle, char *buf, size_t bufsize);
@@ -144,6 +200,9 @@ protected:
 
     static int halt_engine(int status, void*data);
 
+    /** PL_initialise completed */
+    void set_ready();
+
 private slots:
 
     void awake();
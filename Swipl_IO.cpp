@@ -38,7 +38,8 @@
 #include <QTime>
 
 Swipl_IO::Swipl_IO(QObject *parent) :
-    QObject(parent)
+    QObject(parent),
+    signalled(false)
 {
 }
 
@@ -52,7 +53,7 @@ ssize_t Swipl_IO::_read_f(void *handle, char *buf, size_t bufsize) {
 ssize_t Swipl_IO::_write_f(void *handle, char* buf, size_t bufsize) {
     auto e = pq_cast<Swipl_IO>(PlTerm_pointer(handle));
     if (e->target) {
-        emit e->user_output(QString::fromUtf8(buf, bufsize));
+        e->write(buf, bufsize);
         e->flush();
     }
     return bufsize;
@@ -88,7 +89,8 @@ int64_t Swipl_IO::_seek64_f(void *handle, int64_t pos, int whence) {
     return 0;
 }
 
-/** polling loop til buffer ready
+/** blocking loop til buffer ready
+ *  wait on <ready>, until wake() or at most signal_poll msecs, then check Prolog signals
  */
 ssize_t Swipl_IO::_read_(char *buf, size_t bufsize) {
 
@@ -107,66 +109,99 @@ ssize_t Swipl_IO::_read_(char *buf, size_t bufsize) {
                 }
                 break;
             }
+            if (!signalled)
+                ready.wait(&sync, SwiPrologEngine::signal_poll);
+            signalled = false;
         }
 
 	if ( PL_handle_signals() < 0 )
 	    return -1;
-
-        SwiPrologEngine::msleep(10);
     }
 
-    if ( buffer.isEmpty() ) {
+    bool prompt;
+    {   QMutexLocker lk(&sync);
+        prompt = input.empty() && !input.feeding;
+    }
+    if (prompt) {
         PL_write_prompt(TRUE);
 	emit user_prompt(thid, SwiPrologEngine::is_tty(this));
     }
 
     for ( ; ; ) {
 
+        QString call;
         {   QMutexLocker lk(&sync);
 
             if (!query.isEmpty()) {
-                try {
-                    int rc = PlCall(query.toStdWString().data());
-                    qDebug() << "PlCall" << query << rc;
-                }
-                catch(const PlException& e) {
-                    qDebug() << t2w(e.term()); // TODO: e.what()
-                }
+                call = query;
                 query.clear();
             }
+            else {
+                if (!input.empty())
+                    return input.read(buf, bufsize);
 
-            uint n = buffer.length();
-            Q_ASSERT(bufsize >= n);
-            if (n > 0) {
-                uint l = bufsize < n ? bufsize : n;
-                memcpy(buf, buffer, l);
-                buffer.remove(0, l);
-                return l;
+                if (target->status == ConsoleEdit::eof) {
+                    target->status = ConsoleEdit::running;
+                    return 0;
+                }
+
+                if (!signalled)
+                    ready.wait(&sync, SwiPrologEngine::signal_poll);
             }
+            signalled = false;
+        }
 
-            if (target->status == ConsoleEdit::eof) {
-	        target->status = ConsoleEdit::running;
-                return 0;
-	    }
+        // don't hold <sync>: the GUI must not wait for the call
+        if (!call.isEmpty()) {
+            try {
+                int rc = PlCall(call.toStdWString().data());
+                qDebug() << "PlCall" << call << rc;
+            }
+            catch(const PlException& e) {
+                qDebug() << t2w(e.term()); // TODO: e.what()
+            }
         }
 
 	if ( PL_handle_signals() < 0 )
 	    return -1;
-
-        SwiPrologEngine::msleep(10);
     }
 }
 
+void Swipl_IO::wake() {
+    QMutexLocker lk(&sync);
+    signalled = true;
+    ready.wakeAll();
+}
+
 /** syncronized storage of user input from console front end
  */
 void Swipl_IO::user_input(QString s) {
     QMutexLocker lk(&sync);
-    buffer = s.toUtf8();
+    input.push(s.toUtf8());
+    ready.wakeAll();
 }
 
 void Swipl_IO::take_input(QString cmd) {
     QMutexLocker lk(&sync);
-    buffer = cmd.toUtf8();
+    input.push(cmd.toUtf8());
+    ready.wakeAll();
+}
+
+bool Swipl_IO::feed_input(const QByteArray &chunk) {
+    // called from a GUI timer: if the reader is busy, retry on next tick
+    if (!sync.tryLock())
+        return false;
+    bool done = input.offer(chunk);
+    if (done)
+        ready.wakeAll();
+    sync.unlock();
+    return done;
+}
+
+void Swipl_IO::feeding(bool on) {
+    QMutexLocker lk(&sync);
+    input.feeding = on;
+    ready.wakeAll();
 }
 
 void Swipl_IO::eng_at_exit(void *p) {
@@ -178,10 +213,12 @@ void Swipl_IO::attached(ConsoleEdit *c) {
     QMutexLocker lk(&sync);
     Q_ASSERT(target == 0);
     target = c;
+    ready.wakeAll();
 }
 
 void Swipl_IO::query_run(QString newquery) {
     QMutexLocker lk(&sync);
     Q_ASSERT(query.isEmpty());
     query = newquery;
+    ready.wakeAll();
 }
@@ -58,18 +58,33 @@ public:
     /** surrogate signal/slot not working in foreign thread */
     void take_input(QString cmd);
 
+    /** streamed paste: append if there is room */
+    bool feed_input(const QByteArray &chunk);
+
+    /** streamed paste: more input is coming, or done */
+    void feeding(bool on);
+
     /** foreign thread connection completed */
     void attached(ConsoleEdit *c);
 
     void query_run(QString query);
 
+    /** wake up the read loop, after raising a signal */
+    void wake();
+
 private:
 
     /** syncronize inter thread access to buffer and query */
     QMutex sync;
 
-    /** output text buffer, made UTF8 */
-    QByteArray buffer;
+    /** input, query or target changed */
+    QWaitCondition ready;
+
+    /** wake() called, PL_handle_signals() pending */
+    bool signalled;
+
+    /** pending user input, made UTF8 */
+    InputQueue input;
 
     /** factorize access to members */
     ssize_t _read_(char *buf, size_t bufsize);
@@ -82,9 +97,6 @@ private:
 
 signals:
 
-    /** issued to queue a string to user output */
-    void user_output(QString output);
-
     /** issued to peek input - til to CR - from user */
     void user_prompt(int threadId, bool tty);
 
@@ -93,7 +105,7 @@ signals:
 
 public slots:
 
-    /** store string in buffer */
+    /** queue string on input */
     void user_input(QString input);
 };
 
@@ -34,20 +34,41 @@
 #include "ansi_esc_seq.h"
 #include "Preferences.h"
 
-#include <QRegularExpression>
-#include <QDebug>
+ANSI_ESC_SEQ::ANSI_ESC_SEQ()
+{
+    reset();
+}
 
-#define ESC_CSI "\033["
+/** back to plain text and default style
+ */
+void ANSI_ESC_SEQ::reset()
+{
+    state = Text;
+    nparams = 0;
+    is_private = false;
+    current = SGR();
+    clear_styles();
+}
 
-ANSI_ESC_SEQ::ANSI_ESC_SEQ(const QString src, QTextCharFormat &tcf)
-    : src(src),
-      tcf(tcf),
-      off(0),
-      pos(src.indexOf(ESC_CSI)) // note: only CSI right now
+/** restart style numbering: current style becomes 0
+ */
+void ANSI_ESC_SEQ::clear_styles()
 {
+    table.clear();
+    ids.clear();
+    current_id = intern(current);
 }
-ANSI_ESC_SEQ::~ANSI_ESC_SEQ()
+
+int ANSI_ESC_SEQ::intern(const SGR &s)
 {
+    auto k = s.key();
+    auto i = ids.constFind(k);
+    if (i != ids.constEnd())
+        return i.value();
+    int id = table.size();
+    table.append(s);
+    ids.insert(k, id);
+    return id;
 }
 
 /*
@@ -73,102 +94,260 @@ CSI s	SCP - Save Cursor Position	Saves the cursor position/state.
 CSI u	RCP - Restore Cursor Position	Restores the cursor position/state.
 */
 
-void ANSI_ESC_SEQ::Out::setStyle(QTextCharFormat &tcf) const
+/** scan <n> characters, appending text runs
+ *  no allocation, unless runs needs to grow or a new style shows up
+ */
+void ANSI_ESC_SEQ::parse(const QChar *s, int n, QVector<run> &runs)
+{
+    const ushort *u = reinterpret_cast<const ushort*>(s);
+    int i = 0;
+
+    while (i < n) {
+        switch (state) {
+
+        case Text: {
+            int b = i;
+            while (i < n && u[i] != 0x1b && u[i] != '\r' && u[i] != '\b')
+                ++i;
+            if (i > b)
+                runs.append(run {b, i - b, current_id, 0, -1});
+            if (i < n) {
+                if (u[i] == 0x1b)
+                    state = Esc;
+                else
+                    runs.append(run {i, 0, current_id, u[i], -1});
+                ++i;
+            }
+            continue;
+        }
+
+        case Esc:
+            switch (u[i]) {
+            case '[':
+                state = Csi;
+                nparams = 0;
+                is_private = false;
+                break;
+            case ']':
+                state = Osc;
+                break;
+            default:
+                // charset designation and the like carry one more byte
+                state = u[i] >= 0x20 && u[i] <= 0x2F ? EscIntermediate : Text;
+            }
+            break;
+
+        case EscIntermediate:
+            state = Text;
+            break;
+
+        case Csi: {
+            ushort c = u[i];
+            if (c >= '0' && c <= '9') {
+                if (nparams == 0) {
+                    params[0] = 0;
+                    sub[0] = false;
+                    nparams = 1;
+                }
+                int &p = params[nparams - 1];
+                if (p < 0xFFFF)
+                    p = p * 10 + (c - '0');
+            }
+            else if (c == ';' || c == ':') {
+                if (nparams == 0) {
+                    params[0] = 0;
+                    sub[0] = false;
+                    nparams = 1;
+                }
+                if (nparams < max_params) {
+                    params[nparams] = 0;
+                    sub[nparams] = c == ':';
+                    ++nparams;
+                }
+            }
+            else if (c >= 0x3C && c <= 0x3F)
+                is_private = true;
+            else if (c >= 0x40 && c <= 0x7E) {
+                dispatch_csi(c, i, runs);
+                state = Text;
+            }
+            // else intermediate bytes or stray controls: ignored
+            break;
+        }
+
+        case Osc:
+            // operating system command (titles, hyperlinks): dropped
+            if (u[i] == 0x07)
+                state = Text;
+            else if (u[i] == 0x1b)
+                state = OscEsc;
+            break;
+
+        case OscEsc:
+            state = u[i] == '\\' ? Text : Osc;
+            break;
+        }
+        ++i;
+    }
+}
+
+/** SGR changes current style, cursor and erase commands become control runs
+ */
+void ANSI_ESC_SEQ::dispatch_csi(ushort final, int off, QVector<run> &runs)
 {
-    if (mode.fg != SGR::Color::_Color)
-        tcf.setForeground(Preferences::ANSI2col(mode.fg));
-    else if (mode.bright_fg != SGR::Color::_Color)
-        tcf.setForeground(Preferences::ANSI2col(mode.bright_fg, true));
-    else
-        tcf.setForeground(Preferences::ANSI2col(Preferences::console_out_fore));
-
-    if (mode.bg != SGR::Color::_Color)
-        tcf.setBackground(Preferences::ANSI2col(mode.bg));
-    else if (mode.bright_bg != SGR::Color::_Color)
-        tcf.setBackground(Preferences::ANSI2col(mode.bright_bg, true));
-    else
-        tcf.setBackground(Preferences::ANSI2col(Preferences::console_out_back));
-
-    switch (mode.f) {
-    case SGR::Formatting::Bold:
-        tcf.setFontWeight(QFont::Bold);
+    if (is_private)
+        return;
+
+    switch (final) {
+    case CSI::SGR:
+        apply_sgr();
+        break;
+    case CSI::CUU:
+    case CSI::CUD:
+    case CSI::CUF:
+    case CSI::CUB:
+    case CSI::CNL:
+    case CSI::CPL:
+    case CSI::CHA:
+    case CSI::ED:
+    case CSI::EL:
+        runs.append(run {off, 0, current_id, final, nparams > 0 ? params[0] : -1});
         break;
     default:
-        tcf.setFontWeight(QFont::Normal);
+        break;
     }
 }
 
-QString ANSI_ESC_SEQ::next()
+/** apply all parameters of a SGR sequence to current style
+ */
+void ANSI_ESC_SEQ::apply_sgr()
 {
-    Q_ASSERT(*this);
-    Out seq;
-
-    if (off < pos) {
-        // out text before current sequence
-        seq.out = src.mid(off, pos - off);
-        off = pos;
-        return seq.out;
+    if (nparams == 0) {
+        params[0] = 0;
+        sub[0] = false;
+        nparams = 1;
     }
 
-    auto _f = SGR::Formatting::_Formatting;
-    auto _c = SGR::Color::_Color;
-    seq.mode = SGR {
-        _f,
-        _c, _c, _c, _c
-    };
-
-    static QRegularExpression eseq("(0m|39m)|(1;1;1m|1;1m|1m)|(3[0-7]m|3[0-7];1m|3[0-7];1;1m)|(1;3[0-7];1m)|(1;3[0-7]m)|(4[0-7]m)|(9[0-7]m)");
-    QRegularExpressionMatch m = eseq.match(src, pos + 2);
-    QString p;
-
-    //static int z = 0;
-    //qDebug() << "next" << z++ << pos << off << m.hasMatch() << m.capturedTexts() << src;
-
-    if (m.hasMatch()) {
-        if (!(p = m.captured(1)).isNull()) {
-            ; //tcf = save;
-        } else
-        if (!(p = m.captured(2)).isNull()) {
-            seq.mode.f = SGR::Formatting::Bold;
-        } else
-        if (!(p = m.captured(3)).isNull()) {
-            seq.mode.fg = SGR::Color(p[1].digitValue());
-        } else
-        if (!(p = m.captured(4)).isNull()) {
-            //? seq.mode.f = SGR::Formatting::Bold;
-            seq.mode.fg = SGR::Color(p[3].digitValue());
-        } else
-        if (!(p = m.captured(5)).isNull()) {
-            seq.mode.f = SGR::Formatting::Bold;
-            seq.mode.fg = SGR::Color(p[3].digitValue());
-        } else
-        if (!(p = m.captured(6)).isNull()) {
-            seq.mode.bg = SGR::Color(p[1].digitValue());
-        } else
-        if (!(p = m.captured(7)).isNull()) {
-            seq.mode.bright_fg = SGR::Color(p[1].digitValue());
+    SGR &s = current;
+    for (int i = 0; i < nparams; ++i) {
+        int p = params[i];
+        switch (p) {
+        case 0:     s = SGR(); break;
+        case 1:     s.attr |= SGR::Bold; break;
+        case 2:     s.attr |= SGR::Faint; break;
+        case 3:     s.attr |= SGR::Italic; break;
+        case 4:     s.attr |= SGR::Underline; break;
+        case 5:
+        case 6:     s.attr |= SGR::Blink; break;
+        case 7:     s.attr |= SGR::Reverse; break;
+        case 8:     s.attr |= SGR::Conceal; break;
+        case 9:     s.attr |= SGR::Strike; break;
+        case 21:    s.attr |= SGR::Underline; break;    // doubly underlined
+        case 22:    s.attr &= ~(SGR::Bold | SGR::Faint); break;
+        case 23:    s.attr &= ~SGR::Italic; break;
+        case 24:    s.attr &= ~SGR::Underline; break;
+        case 25:    s.attr &= ~SGR::Blink; break;
+        case 27:    s.attr &= ~SGR::Reverse; break;
+        case 28:    s.attr &= ~SGR::Conceal; break;
+        case 29:    s.attr &= ~SGR::Strike; break;
+        case 39:    s.fg_kind = SGR::Default; s.fg = 0; break;
+        case 49:    s.bg_kind = SGR::Default; s.bg = 0; break;
+
+        case 38:
+        case 48: {
+            // extended color: 5;N or 2;R;G;B, either ';' or ':' separated
+            // the ':' form can hold a (empty) color space id before R
+            quint8 kind = SGR::Default;
+            quint32 v = 0;
+            int j = i + 1;
+            if (j < nparams) {
+                int rest = 0;
+                while (j + 1 + rest < nparams && sub[j + 1 + rest])
+                    ++rest;
+                if (params[j] == 5 && j + 1 < nparams) {
+                    kind = SGR::Indexed;
+                    v = quint32(params[j + 1] & 0xFF);
+                    i = j + 1;
+                }
+                else if (params[j] == 2) {
+                    int r = j + 1;
+                    if (sub[j] && rest >= 4)
+                        ++r;
+                    if (r + 2 < nparams) {
+                        kind = SGR::RGB;
+                        v = quint32(params[r] & 0xFF) << 16 | quint32(params[r + 1] & 0xFF) << 8 | quint32(params[r + 2] & 0xFF);
+                        i = r + 2;
+                    }
+                    else
+                        i = nparams;
+                }
+                else
+                    i = j;
+            }
+            if (kind != SGR::Default) {
+                if (p == 38)
+                    s.fg_kind = kind, s.fg = v;
+                else
+                    s.bg_kind = kind, s.bg = v;
+            }
+            break;
         }
 
-        if (!p.isNull()) {
-            seq.setStyle(tcf);
+        default:
+            if (p >= 30 && p <= 37)
+                s.fg_kind = SGR::Indexed, s.fg = quint32(p - 30);
+            else if (p >= 40 && p <= 47)
+                s.bg_kind = SGR::Indexed, s.bg = quint32(p - 40);
+            else if (p >= 90 && p <= 97)
+                s.fg_kind = SGR::Indexed, s.fg = quint32(p - 90 + 8);
+            else if (p >= 100 && p <= 107)
+                s.bg_kind = SGR::Indexed, s.bg = quint32(p - 100 + 8);
+            // else unsupported (fonts, frames...), ignored
+        }
+    }
 
-            // text to output
-            off = pos + 2 + p.length();
-            pos = src.indexOf(ESC_CSI, off);
-            if (pos == -1)
-                seq.out = src.mid(off);
-            else
-                seq.out = src.mid(off, pos - off);
-            off = pos;
+    current_id = intern(s);
+}
 
+/** resolve a color in 256 colors palette or truecolor
+ */
+QColor ANSI_ESC_SEQ::SGR::color(quint8 kind, quint32 v, bool foreground)
+{
+    switch (kind) {
+    case RGB:
+        return QColor(int(v >> 16 & 0xFF), int(v >> 8 & 0xFF), int(v & 0xFF));
+    case Indexed:
+        if (v < 16)
+            return Preferences::ANSI2col(int(v & 7), v >= 8);
+        if (v < 232) {
+            static const int level[] = { 0, 95, 135, 175, 215, 255 };
+            v -= 16;
+            return QColor(level[v / 36], level[v / 6 % 6], level[v % 6]);
         } else {
-            qDebug() << "extraction failed!" << src.right(pos + 2).mid(5);
+            int g = 8 + 10 * int(v - 232);
+            return QColor(g, g, g);
         }
-
-    } else {
-        qDebug() << "no pattern match!" << src.right(pos + 2).mid(5);
-        pos = -1;
+    default:
+        return Preferences::ANSI2col(foreground ? Preferences::console_out_fore : Preferences::console_out_back);
     }
+}
+
+/** apply to text format, default colors from preferences
+ */
+void ANSI_ESC_SEQ::SGR::setStyle(QTextCharFormat &tcf) const
+{
+    QColor f = color(fg_kind, fg, true), b = color(bg_kind, bg, false);
+    if (attr & Reverse)
+        std::swap(f, b);
+    if (attr & Conceal)
+        f = b;
+    else if (attr & Faint)
+        f = QColor((f.red() + b.red()) / 2, (f.green() + b.green()) / 2, (f.blue() + b.blue()) / 2);
 
-    return seq.out;
+    tcf.setForeground(f);
+    tcf.setBackground(b);
+    tcf.setFontWeight(attr & Bold ? QFont::Bold : QFont::Normal);
+    tcf.setFontItalic(attr & Italic);
+    tcf.setFontUnderline(attr & Underline);
+    tcf.setFontStrikeOut(attr & Strike);
 }
@@ -34,6 +34,8 @@
 #ifndef ANSI_ESC_SEQ_H
 #define ANSI_ESC_SEQ_H
 
+#include <QHash>
+#include <QVector>
 #include <QTextCharFormat>
 
 // parse a subset of ANSI ESCAPE sequences
@@ -45,21 +47,75 @@
 // the cursor location, color, and other options
 // on video text terminals and terminal emulators.
 //
-// Implementation of CSI would require to directly perform on QTextCursor
-//  that's not implied in this fix to swipl-win. So, we're left with SGR.
-// But I will consider it for application of multilevel DCG cursor.
+// The parser is a single pass state machine over the decoded buffer:
+// it splits text in (offset, length, style) runs, removing the sequences.
+// State is kept between calls, so a sequence can span buffer boundaries.
+// SGR is fully applied, cursor movement and erase (CR, BS, CUU...CHA, ED, EL)
+// are passed as control runs, to be applied in place by the console.
+// Other CSI and OSC are recognized and dropped.
 //
 class ANSI_ESC_SEQ
 {
 public:
 
-    ANSI_ESC_SEQ(const QString src, QTextCharFormat &tcf);
-    ~ANSI_ESC_SEQ();
+    // SGR (Select Graphic Rendition) sets display attributes.
+    // Several attributes can be set in the same sequence, separated by semicolons.
+    // Each display attribute remains in effect until a following occurrence of SGR resets it.
+    // If no codes are given, CSI m is treated as CSI 0 m (reset / normal).
+    struct SGR {
+        enum Attribute {
+            Bold = 1, Faint = 2, Italic = 4, Underline = 8,
+            Blink = 16, Reverse = 32, Conceal = 64, Strike = 128
+        };
+        enum Color {
+            Default,    // console preferences
+            Indexed,    // 256 colors palette, first 16 from preferences
+            RGB,        // truecolor 0xRRGGBB
+        };
+
+        quint8 attr = 0;
+        quint8 fg_kind = Default, bg_kind = Default;
+        quint32 fg = 0, bg = 0;
+
+        /** all of the state packed, used as style identity */
+        quint64 key() const {
+            return quint64(attr) | quint64(fg_kind) << 8 | quint64(bg_kind) << 10 |
+                   quint64(fg & 0xFFFFFF) << 12 | quint64(bg & 0xFFFFFF) << 36;
+        }
+
+        /** apply to text format, default colors from preferences */
+        void setStyle(QTextCharFormat &tcf) const;
 
-    operator bool() const { return pos >= 0; }
-    QString next();
+        /** resolve a color in 256 colors palette or truecolor */
+        static QColor color(quint8 kind, quint32 value, bool foreground);
+    };
 
-private:
+    /** text between sequences, offsets relative to the parsed buffer,
+     *  or a control when op is not 0: '\r', '\b' or a CSI final byte
+     */
+    struct run {
+        int off, len;
+        int style;      // index in styles()
+        int op;         // 0 for text
+        int n;          // first CSI parameter, -1 if omitted
+
+        /** CSI parameter, with default when omitted */
+        int arg(int def) const { return n < 0 ? def : n; }
+    };
+
+    ANSI_ESC_SEQ();
+
+    /** scan <n> characters, appending text runs */
+    void parse(const QChar *s, int n, QVector<run> &runs);
+
+    /** styles referenced by runs, valid until clear_styles() */
+    const QVector<SGR>& styles() const { return table; }
+
+    /** restart style numbering: current style becomes 0 */
+    void clear_styles();
+
+    /** back to plain text and default style */
+    void reset();
 
     // For CSI, or "Control Sequence Introducer" commands, the ESC [
     // is followed by any number (including none) of "parameter bytes" in the range 0x30-0x3F (ASCII 0-9:;<=>?),
@@ -86,30 +142,27 @@ private:
         int n;
     };
 
-    // SGR (Select Graphic Rendition) sets display attributes.
-    // Several attributes can be set in the same sequence, separated by semicolons.
-    // Each display attribute remains in effect until a following occurrence of SGR resets it.
-    // If no codes are given, CSI m is treated as CSI 0 m (reset / normal).
-    struct SGR {
-        enum Formatting {
-            Bold, Underline, Italic, Blink,
-            _Formatting, // unknown
-        } f;
-        enum Color {
-            Black, Red, Green, Yellow, Blue, Magenta, Cyan, White,
-            _Color,      // unknown
-        } fg, bg, bright_fg, bright_bg;
-    };
+private:
 
-    struct Out {
-        QString out;
-        SGR mode;
-        void setStyle(QTextCharFormat &tcf) const;
-    };
+    enum state_t { Text, Esc, EscIntermediate, Csi, Osc, OscEsc };
+    state_t state;
+
+    /** CSI parameters being collected, <sub> marks ':' separated ones */
+    enum { max_params = 16 };
+    int params[max_params];
+    bool sub[max_params];
+    int nparams;
+    bool is_private;
+
+    void dispatch_csi(ushort final, int off, QVector<run> &runs);
+    void apply_sgr();
+
+    SGR current;
+    int current_id;
 
-    const QString src;
-    QTextCharFormat &tcf;
-    int off = 0, pos;
+    QVector<SGR> table;
+    QHash<quint64, int> ids;
+    int intern(const SGR &s);
 };
 
 #endif // ANSI_ESC_SEQ_H
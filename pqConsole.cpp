@@ -43,6 +43,7 @@
 #include "ConsoleEdit.h"
 #include "Preferences.h"
 #include "pqMainWindow.h"
+#include "PredicateIndex.h"
 
 #include <QTime>
 #include <QStack>
@@ -94,16 +95,10 @@ static QWidget *search_widget(std::function<bool(QWidget* w)> match) {
     return 0;
 }
 
-/** search widgets hierarchy looking for the first (the only)
- *  that owns the calling thread ID
+/** the console that owns the calling thread ID
  */
 static ConsoleEdit *console_by_thread() {
-    int thid = PL_thread_self();
-    return qobject_cast<ConsoleEdit*>(search_widget([=](QWidget* p) {
-	if (auto ce = qobject_cast<ConsoleEdit*>(p))
-	    return ce->match_thread(thid);
-	return false;
-    }));
+    return ConsoleEdit::by_thread(PL_thread_self());
 }
 
 /** search widgets hierarchy looking for any ConsoleEdit
@@ -311,7 +306,7 @@ PREDICATE0(win_has_menu) {
 PREDICATE(win_insert_menu, 2) {
     if (ConsoleEdit *ce = console_by_thread()) {
 	QString Label = t2w(PL_A1), Before = t2w(PL_A2);
-	ce->exec_func([=]() {
+	ce->gui_post([=]() {
 	    if (auto mw = qobject_cast<QMainWindow*>(ce->parentWidget())) {
 		auto mbar = mw->menuBar();
 		foreach (QAction *ac, mbar->actions())
@@ -372,7 +367,7 @@ PREDICATE(win_insert_menu_item, 4) {
 	// if (PlCall("context_module", cx)) ctxtmod = t2w(cx); -- same as above: system
 	ctxtmod = "win_menu";
 
-	ce->exec_func([=]() {
+	ce->gui_post([=]() {
 	    if (auto mw = qobject_cast<pqMainWindow*>(ce->parentWidget())) {
 		foreach (QAction *ac, mw->menuBar()->actions())
 		    if (ac->text() == Pulldown) {
@@ -422,6 +417,14 @@ PREDICATE(win_insert_menu_item, 4) {
     return FALSE;
 }
 
+/** bytes buffered by the calling thread streams go to the console ring,
+ *  where the GUI command will find them: see ConsoleEdit::flush_output
+ */
+static void flush_streams() {
+    Sflush(Suser_output);
+    Sflush(Suser_error);
+}
+
 /** tty_clear
  *  as requested by Annie. Should as well be implemented capturing ANSI terminal sequence
  */
@@ -429,19 +432,11 @@ PREDICATE0(tty_clear) {
     ConsoleEdit* c = console_by_thread();
     if (c) {
 
-	// loqt does better...
-	// pqConsole::gui_run([&]() { c->tty_clear(); });
-
-	ConsoleEdit::exec_sync s;
-	c->exec_func([&]() {
+	flush_streams();
+	c->gui_call<void>([=]() {
+	    c->flush_output();
 	    c->tty_clear();
-	    s.go();
 	});
-	s.stop();
-
-	// buggy - need to sync
-	// c->tty_clear();
-
 	return TRUE;
     }
     return FALSE;
@@ -599,11 +594,8 @@ PREDICATE(win_message_box, 2) {
 	    else
 		throw PlException(A(c->tr("option %1 : invalid arity").arg(t2w(Option))));
 
-	int rc;
 	QString err;
-	ConsoleEdit::exec_sync s;
-
-	c->exec_func([&]() {
+	bool rc = c->gui_call<bool>([&]() {
 
 	    QMessageBox mbox(c);
 
@@ -612,7 +604,7 @@ PREDICATE(win_message_box, 2) {
 	    if (!Image.isEmpty()) {
 		if (!imfile.load(Image)) {
 		    err = c->tr("icon file %1 not found").arg(Image);
-		    return;
+		    return false;
 		}
 		if (scale)
 		    imfile = imfile.scaled(imfile.size() * scale,
@@ -630,10 +622,8 @@ PREDICATE(win_message_box, 2) {
 		layout->addItem(horizontalSpacer, layout->rowCount(), 0, 1, layout->columnCount());
 	    }
 
-	    rc = mbox.exec() == mbox.Ok;
-	    s.go();
+	    return mbox.exec() == mbox.Ok;
 	});
-	s.stop();
 
 	if (!err.isEmpty())
 	    throw PlException(A(err));
@@ -663,11 +653,23 @@ PREDICATE0(interrupt) {
 /** set/get settings of thread associated console
  *  some selected property
  *
+ *  frameRate(N) default 60
+ *  - output display frames per second, shared by all consoles
+ *
  *  updateRefreshRate(N) default 100
- *  - allow to alter default refresh rate (simply count outputs before setting cursor at end)
+ *  - deprecated, no effect: output is displayed once per frame, see frameRate
+ *
+ *  outputBacklog(N) default 262144
+ *  - bytes of pending output before a writer thread waits for the GUI (0: ring capacity)
+ *
+ *  scrollbackLines(N) default 5000
+ *  - lines kept in the document, older ones are moved to scrollback and paged back in scrolling up (0: keep all)
+ *
+ *  scrollbackMemory(N) default 64
+ *  - MB of scrollback kept in memory, older lines spill to a temporary file (0: never spill)
  *
  *  maximumBlockCount(N) default 0
- *  - remove (from top) text lines when exceeding the limit
+ *  - remove (from top) text lines when exceeding the limit - they are lost, see scrollbackLines
  *
  *  lineWrapMode(Mode) Mode --> 'NoWrap' | 'WidgetWidth'
  *  - when NoWrap, an horizontal scroll bar could display
@@ -699,13 +701,9 @@ PREDICATE(getOpenFileName, 4) {
 	if (PL_A2.type() == PL_ATOM)
 	    StartPath = t2w(PL_A2);
 
-	ConsoleEdit::exec_sync s;
-
-	c->exec_func([&]() {
-	    Choice = QFileDialog::getOpenFileName(c, Caption, StartPath, Pattern);
-	    s.go();
+	Choice = c->gui_call<QString>([&]() {
+	    return QFileDialog::getOpenFileName(c, Caption, StartPath, Pattern);
 	});
-	s.stop();
 
 	if (!Choice.isEmpty()) {
 	    PlCheckFail(PL_A4.unify_atom(A(Choice)));
@@ -726,12 +724,9 @@ PREDICATE(getSaveFileName, 4) {
 	if (PL_A2.type() == PL_ATOM)
 	    StartPath = t2w(PL_A2);
 
-	ConsoleEdit::exec_sync s;
-	c->exec_func([&]() {
-	    Choice = QFileDialog::getSaveFileName(c, Caption, StartPath, Pattern);
-	    s.go();
+	Choice = c->gui_call<QString>([&]() {
+	    return QFileDialog::getSaveFileName(c, Caption, StartPath, Pattern);
 	});
-	s.stop();
 
 	if (!Choice.isEmpty()) {
 	    PlCheckFail(PL_A4.unify_atom(A(Choice)));
@@ -748,17 +743,12 @@ PREDICATE0(select_font) {
     ConsoleEdit* c = console_by_thread();
     bool ok = false;
     if (c) {
-	ConsoleEdit::exec_sync s;
-	c->exec_func([&]() {
+	c->gui_call<void>([&]() {
 	    Preferences p;
-	    qDebug() << "Opening font dialog";
 	    QFont font = QFontDialog::getFont(&ok, p.console_font, c);
-	    qDebug() << "ok = " << ok << "font = " << font;
 	    if (ok)
 		c->setFont(p.console_font = font);
-	    s.go();
 	});
-	s.stop();
     }
     return ok;
 }
@@ -770,8 +760,7 @@ PREDICATE0(select_ANSI_term_colors) {
     ConsoleEdit* c = console_by_thread();
     bool ok = false;
     if (c) {
-	ConsoleEdit::exec_sync s;
-	c->exec_func([&]() {
+	c->gui_call<void>([&]() {
 	    Preferences p;
 	    QColorDialog d(c);
 	    d.setOption(QColorDialog::ColorDialogOption::DontUseNativeDialog);
@@ -781,12 +770,11 @@ PREDICATE0(select_ANSI_term_colors) {
 	    if (d.exec()) {
 		for (int i = 0; i < p.ANSI_sequences.size(); ++i)
 		    p.ANSI_sequences[i] = d.customColor(i);
+		c->set_colors();
 		c->repaint();
 		ok = true;
 	    }
-	    s.go();
 	});
-	s.stop();
 	return ok;
     }
     return FALSE;
@@ -799,7 +787,7 @@ PREDICATE0(quit_console) {
     ConsoleEdit* c = console_by_thread();
     if (c) {
 	// run on foreground
-	c->exec_func([=]() {
+	c->gui_post([=]() {
 	if (auto mw = find_parent<pqMainWindow>(c))
 	    QApplication::postEvent(mw, new QCloseEvent);
 	});
@@ -813,7 +801,7 @@ PREDICATE0(quit_console) {
 PREDICATE0(copy) {
     ConsoleEdit* c = console_by_thread();
     if (c) {
-	c->exec_func([=](){
+	c->gui_post([=](){
 	    QApplication::clipboard()->setText(c->textCursor().selectedText());
 	    do_events();
 	});
@@ -827,7 +815,9 @@ PREDICATE0(copy) {
 PREDICATE0(paste) {
     ConsoleEdit* c = console_by_thread();
     if (c) {
-	c->exec_func([=](){
+	flush_streams();
+	c->gui_post([=](){
+	    c->flush_output();
 	    c->textCursor().insertText(QApplication::clipboard()->text());
 	    do_events();
 	});
@@ -836,6 +826,30 @@ PREDICATE0(paste) {
     return FALSE;
 }
 
+/** console_find(+Text)
+ *  select the previous occurrence of Text, searching scrollback too
+ */
+PREDICATE(console_find, 1) {
+    ConsoleEdit* c = console_by_thread();
+    if (c) {
+	QString text = t2w(PL_A1);
+	flush_streams();
+	return c->gui_call<bool>([&]() {
+	    c->flush_output();
+	    return c->find_history(text);
+	});
+    }
+    return FALSE;
+}
+
+/** pq_module_loaded(+Module)
+ *  called by message_hook on load_file done, keeps completion index current
+ */
+PREDICATE(pq_module_loaded, 1) {
+    PredicateIndex::instance()->module_loaded(t2w(PL_A1));
+    return TRUE;
+}
+
 #undef PROLOG_MODULE
 #define PROLOG_MODULE "system"
 
@@ -898,12 +912,11 @@ PREDICATE(win_html_write, 1) {
     if (c) {
 	// run on foreground
 	QString html = t2w(PL_A1);
-	ConsoleEdit::exec_sync s;
-	c->exec_func([&]() {
+	flush_streams();
+	c->gui_call<void>([&]() {
+	    c->flush_output();
 	    c->html_write(html);
-	    s.go();
 	});
-	s.stop();
 	return TRUE;
     }
     return FALSE;
@@ -921,8 +934,7 @@ PREDICATE(win_window_color, 2) {
 	    QRgb val = qRgb(r, g, b);
 	    auto which = t2w(PL_A1);
 
-	    ConsoleEdit::exec_sync s;
-	    c->exec_func([&]() {
+	    c->gui_call<void>([&]() {
 		auto setcp = [=](QPalette::ColorRole r, int out = -1, int inp = -1) {
 		    auto p = c->palette();
 		    p.setColor(QPalette::Active, r, val);
@@ -942,10 +954,7 @@ PREDICATE(win_window_color, 2) {
 		    setcp(QPalette::HighlightedText);
 		else if (which == "selection_background")
 		    setcp(QPalette::Highlight);
-
-		s.go();
 	    });
-	    s.stop();
 	    return TRUE;
 	}
 	//throw PlDomainError(err_expected_desc, err_expected_term);
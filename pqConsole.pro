@@ -30,7 +30,17 @@ SOURCES += \
     Swipl_IO.cpp \
     pqMainWindow.cpp \
     Preferences.cpp \
-    FlushOutputEvents.cpp
+    FlushOutputEvents.cpp \
+    OutputRing.cpp \
+    Scrollback.cpp \
+    OutputPipe.cpp \
+    RepaintScheduler.cpp \
+    InputQueue.cpp \
+    QueryExecutor.cpp \
+    GuiCommands.cpp \
+    PredicateIndex.cpp \
+    FuzzyMatch.cpp \
+    DocIndex.cpp
 
 HEADERS += \
     pqConsole.h \
@@ -44,7 +54,18 @@ HEADERS += \
     pqMainWindow.h \
     Preferences.h \
     do_events.h \
-    FlushOutputEvents.h
+    BlockData.h \
+    FlushOutputEvents.h \
+    OutputRing.h \
+    Scrollback.h \
+    OutputPipe.h \
+    RepaintScheduler.h \
+    InputQueue.h \
+    QueryExecutor.h \
+    GuiCommands.h \
+    PredicateIndex.h \
+    FuzzyMatch.h \
+    DocIndex.h
 
 symbian {
     MMP_RULES += EXPORTUNFROZEN
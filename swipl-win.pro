@@ -77,7 +77,17 @@ SOURCES += main.cpp \
     Completion.cpp \
     swipl_win.cpp \
     ParenMatching.cpp \
-    ansi_esc_seq.cpp
+    ansi_esc_seq.cpp \
+    OutputRing.cpp \
+    Scrollback.cpp \
+    OutputPipe.cpp \
+    RepaintScheduler.cpp \
+    InputQueue.cpp \
+    QueryExecutor.cpp \
+    GuiCommands.cpp \
+    PredicateIndex.cpp \
+    FuzzyMatch.cpp \
+    DocIndex.cpp
 
 RESOURCES += \
     swipl-win.qrc
@@ -100,6 +110,17 @@ HEADERS += \
     Completion.h \
     swipl_win.h \
     blockSig.h \
+    BlockData.h \
     lqUty_global.h \
     ParenMatching.h \
-    ansi_esc_seq.h
+    ansi_esc_seq.h \
+    OutputRing.h \
+    Scrollback.h \
+    OutputPipe.h \
+    RepaintScheduler.h \
+    InputQueue.h \
+    QueryExecutor.h \
+    GuiCommands.h \
+    PredicateIndex.h \
+    FuzzyMatch.h \
+    DocIndex.h
@@ -52,6 +52,8 @@ bool swipl_win::event(QEvent *event) {
 
         qDebug() << "FileOpen: " << name;
         SwiPrologEngine::in_thread _it;
+        if (!_it)
+            return true;
         try {
             PlCall("prolog", "file_open_event", PlTermv(PlTerm_atom(name.toStdWString())));
         } catch(const PlException& e) {
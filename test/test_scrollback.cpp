@@ -0,0 +1,120 @@
+/*  Part of SWI-Prolog interface to Qt
+
+    Author:        SWI-Prolog contributors
+    WWW:           https://www.swi-prolog.org
+    Copyright (c)  2026, SWI-Prolog contributors
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions
+    are met:
+
+    1. Redistributions of source code must retain the above copyright
+       notice, this list of conditions and the following disclaimer.
+
+    2. Redistributions in binary form must reproduce the above copyright
+       notice, this list of conditions and the following disclaimer in
+       the documentation and/or other materials provided with the
+       distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+    FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+    COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+    INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+    BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+    LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+    ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "Scrollback.h"
+#include <QtTest>
+#include <QTextDocument>
+
+/** Scrollback store and restore, in memory and spilled to disk
+ */
+class test_scrollback : public QObject {
+    Q_OBJECT
+
+    /** a document of <n> lines: L0 ... L<n-1> */
+    static void fill(QTextDocument &d, int n) {
+        QStringList l;
+        for (int i = 0; i < n; ++i)
+            l << QString("L%1").arg(i);
+        d.setPlainText(l.join('\n'));
+    }
+
+    /** move all lines of <d> to <s>, oldest first */
+    static void store(Scrollback &s, QTextDocument &d) {
+        for (QTextBlock b = d.begin(); b.isValid(); b = b.next())
+            s.append(b);
+    }
+
+    /** restored lines must be L0 ... L<n-1>, followed by the empty last block */
+    static void check(QTextDocument &d, int n) {
+        QCOMPARE(d.blockCount(), n + 1);
+        QTextBlock b = d.begin();
+        for (int i = 0; i < n; ++i, b = b.next())
+            QCOMPARE(b.text(), QString("L%1").arg(i));
+    }
+
+private slots:
+
+    void restore_in_memory() {
+        QTextDocument src, dst;
+        const int n = 3 * Scrollback::chunk_lines + 10;
+        fill(src, n);
+
+        Scrollback s;
+        store(s, src);
+        QCOMPARE(s.lines(), n);
+
+        QTextCursor c(&dst);
+        int restored = 0;
+        for (int k; (k = s.restore(c)) > 0; )
+            restored += k;
+        QCOMPARE(restored, n);
+        QCOMPARE(s.lines(), 0);
+        check(dst, n);
+    }
+
+    void restore_spilled() {
+        QTextDocument src, dst;
+        const int n = 3 * Scrollback::chunk_lines + 10;
+        fill(src, n);
+
+        Scrollback s;
+        s.setMemoryLimit(1);
+        store(s, src);
+        QVERIFY(s.spilledBytes() > 0);
+
+        // the same cursor for every chunk, as a pager does
+        QTextCursor c(&dst);
+        int restored = 0;
+        for (int k; (k = s.restore(c)) > 0; )
+            restored += k;
+        QCOMPARE(restored, n);
+        QCOMPARE(s.spilledBytes(), qint64(0));
+        check(dst, n);
+    }
+
+    void search_depth() {
+        QTextDocument src;
+        const int n = 2 * Scrollback::chunk_lines;
+        fill(src, n);
+
+        Scrollback s;
+        s.setMemoryLimit(1);
+        store(s, src);
+        QCOMPARE(s.search("L0"), n);
+        QCOMPARE(s.search(QString("L%1").arg(n - 1)), 1);
+        QCOMPARE(s.search("missing"), 0);
+    }
+};
+
+QTEST_MAIN(test_scrollback)
+#include "test_scrollback.moc"